@@ -17,6 +17,7 @@ uniform float u_TranslateY;
 uniform float u_Zoom;
 uniform float u_WindowWidth;
 uniform float u_WindowHeight;
+uniform vec2 u_ViewportOrigin;
 
 uniform float u_Wk;
 uniform float u_MuK;
@@ -24,31 +25,25 @@ uniform float u_SigmaK2;
 uniform float u_MuG;
 uniform float u_SigmaG2;
 
-uniform bool u_ShowFields;
-uniform int u_FieldType;
+// Compile-time view options: FIELD_TYPE picks the field overlay (0 = none),
+// SHOW_FOOD draws the food layer and PARTICLE_IMAGE composites the tiled
+// rasteriser's output.
+#ifndef FIELD_TYPE
+#define FIELD_TYPE 0
+#endif
 
 
 uniform sampler2D u_FoodTexture;
-uniform bool u_ShowFood;
 uniform int u_FoodGridSize;
 
-const vec3 BACKGROUND = vec3(0.005, 0.02, 0.05);
-
 
-vec3 hsl2rgb(vec3 c) {
-    vec3 rgb = clamp(abs(mod(c.x * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
-    return c.z + c.y * (rgb - 0.5) * (1.0 - abs(2.0 * c.z - 1.0));
-}
+uniform sampler2D u_ParticleImage;
 
-vec3 speciesColor(float species, float energy) {
-    float hue = mod(species * 0.3, 1.0);
-    return hsl2rgb(vec3(hue, 0.7 + energy * 0.3, 0.3 + energy * 0.4));
-}
+const vec3 BACKGROUND = vec3(0.005, 0.02, 0.05);
 
 
 #define READ_PARTICLE_POS(i) vec2(particles[(i) * 15], particles[(i) * 15 + 1])
 #define READ_PARTICLE_MASS(i) particles[(i) * 15 + 6]
-#define READ_PARTICLE_SPECIES(i) particles[(i) * 15 + 7]
 
 
 
@@ -96,7 +91,8 @@ void main() {
     
     
     
-    if (u_ShowFields && u_FieldType > 0) {
+#if FIELD_TYPE > 0
+    {
         ivec2 pixelCoord = ivec2(gl_FragCoord.xy);
         
         
@@ -131,18 +127,25 @@ void main() {
             float fieldVal = 0.0;
             vec3 fieldColor = vec3(0.0, 0.3, 0.8);
             
-            if (u_FieldType == 1) {
+#if FIELD_TYPE == 1
+            {
                 fieldVal = min(density * 2.0, 1.0);
                 fieldColor = vec3(0.0, 0.3, 0.8);
-            } else if (u_FieldType == 2) {
+            }
+#elif FIELD_TYPE == 2
+            {
                 fieldVal = min(separation, 1.0);
                 fieldColor = vec3(0.8, 0.2, 0.0);
-            } else if (u_FieldType == 3) {
+            }
+#elif FIELD_TYPE == 3
+            {
                 float u_diff = density - u_MuG;
                 float growth = exp(-u_diff * u_diff / u_SigmaG2);
                 fieldVal = growth;
                 fieldColor = vec3(0.0, 0.8, 0.3);
-            } else if (u_FieldType == 4) {
+            }
+#elif FIELD_TYPE == 4
+            {
                 float u_diff = density - u_MuG;
                 float growth = exp(-u_diff * u_diff / u_SigmaG2);
                 float e = separation - growth;
@@ -154,6 +157,7 @@ void main() {
                     fieldColor = vec3(0.0, 0.8, 0.3);
                 }
             }
+#endif
             
             color = mix(BACKGROUND, fieldColor, fieldVal * 0.4);
         } else {
@@ -161,10 +165,12 @@ void main() {
             color = BACKGROUND * 1.1;
         }
     }
+#endif
     
     
     
-    if (u_ShowFood) {
+#ifdef SHOW_FOOD
+    {
         
         
         vec2 foodUV = (worldPos + vec2(u_WorldWidth, u_WorldHeight) * 0.5) / vec2(u_WorldWidth, u_WorldHeight);
@@ -195,54 +201,14 @@ void main() {
             color = mix(color, foodColor, foodGlow);
         }
     }
+#endif
     
     
-    float minDist2 = 1000.0;
-    vec3 closestColor = vec3(1.0);
-    float closestEnergy = 0.0;
-    
-    float glowRadius = 0.5 / u_Zoom;
-    float glowRadius2 = glowRadius * glowRadius;
-    
-    
-    for (int i = 0; i < u_NumParticles; i++) {
-        float mass = READ_PARTICLE_MASS(i);
-        if (mass < 0.01) continue;
-        
-        vec2 ppos = READ_PARTICLE_POS(i);
-        float d2 = wrappedDist2(worldPos, ppos);
-        
-        
-        if (d2 > glowRadius2 && minDist2 < glowRadius2) continue;
-        
-        if (d2 < minDist2) {
-            minDist2 = d2;
-            closestEnergy = mass;
-            closestColor = speciesColor(READ_PARTICLE_SPECIES(i), mass);
-        }
-    }
-    
-    float minDist = sqrt(minDist2);
-    float particleRadius = 0.15 / u_Zoom;
-    
-    
-    if (minDist < glowRadius) {
-        float glow = 1.0 - minDist / glowRadius;
-        glow *= glow;
-        color = mix(color, closestColor * 0.5, glow * closestEnergy * 0.5);
-    }
-    
-    
-    if (minDist < particleRadius) {
-        float core = 1.0 - minDist / particleRadius;
-        core = sqrt(core);
-        color = mix(color, closestColor, core);
-    }
-    
-    
-    if (minDist < particleRadius * 0.3) {
-        color = mix(color, vec3(1.0), 0.8);
-    }
+#ifdef PARTICLE_IMAGE
+    vec4 splat = texelFetch(u_ParticleImage,
+                            ivec2(gl_FragCoord.xy - u_ViewportOrigin), 0);
+    color = color * (1.0 - splat.a) + splat.rgb;
+#endif
     
     FragColor = vec4(color, 1.0);
 }
@@ -0,0 +1,53 @@
+#version 450 core
+
+ 
+
+in vec2 vOffset;
+in vec2 vWorldPos;
+flat in vec3 vColor;
+flat in float vEnergy;
+
+out vec4 FragColor;
+
+uniform float u_WorldWidth;
+uniform float u_WorldHeight;
+uniform float u_Zoom;
+
+// Accumulates mix(dst, target, a) as dst * k + C so the same glow / core /
+// highlight stack as the old nearest-particle search can be applied with
+// glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+void layer(inout vec3 C, inout float k, vec3 target, float a) {
+    C = C * (1.0 - a) + target * a;
+    k *= 1.0 - a;
+}
+
+void main() {
+    if (abs(vWorldPos.x) > u_WorldWidth * 0.5 || abs(vWorldPos.y) > u_WorldHeight * 0.5) {
+        discard;
+    }
+
+    float glowRadius = 0.5 / u_Zoom;
+    float particleRadius = 0.15 / u_Zoom;
+    float dist = length(vOffset);
+    if (dist >= glowRadius) discard;
+
+    
+    gl_FragDepth = dist / glowRadius;
+
+    vec3 C = vec3(0.0);
+    float k = 1.0;
+
+    float glow = 1.0 - dist / glowRadius;
+    glow *= glow;
+    layer(C, k, vColor * 0.5, glow * vEnergy * 0.5);
+
+    if (dist < particleRadius) {
+        layer(C, k, vColor, sqrt(1.0 - dist / particleRadius));
+    }
+
+    if (dist < particleRadius * 0.3) {
+        layer(C, k, vec3(1.0), 0.8);
+    }
+
+    FragColor = vec4(C, 1.0 - k);
+}
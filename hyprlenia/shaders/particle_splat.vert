@@ -0,0 +1,82 @@
+#version 450 core
+
+ 
+
+layout(std430, binding = 0) readonly buffer Particles {
+    float particles[];
+};
+
+uniform float u_WorldWidth;
+uniform float u_WorldHeight;
+uniform float u_TranslateX;
+uniform float u_TranslateY;
+uniform float u_Zoom;
+uniform float u_WindowWidth;
+uniform float u_WindowHeight;
+
+out vec2 vOffset;
+out vec2 vWorldPos;
+flat out vec3 vColor;
+flat out float vEnergy;
+
+#define READ_PARTICLE_POS(i) vec2(particles[(i) * 15], particles[(i) * 15 + 1])
+#define READ_PARTICLE_MASS(i) particles[(i) * 15 + 6]
+#define READ_PARTICLE_SPECIES(i) particles[(i) * 15 + 7]
+
+vec3 hsl2rgb(vec3 c) {
+    vec3 rgb = clamp(abs(mod(c.x * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
+    return c.z + c.y * (rgb - 0.5) * (1.0 - abs(2.0 * c.z - 1.0));
+}
+
+vec3 speciesColor(float species, float energy) {
+    float hue = mod(species * 0.3, 1.0);
+    return hsl2rgb(vec3(hue, 0.7 + energy * 0.3, 0.3 + energy * 0.4));
+}
+
+void main() {
+    // Four instances per particle: the particle itself plus its periodic
+    // images across the x, y and corner edges, so glows wrap like the
+    // wrapped-distance search did.
+    int idx = gl_InstanceID >> 2;
+    int image = gl_InstanceID & 3;
+    float mass = READ_PARTICLE_MASS(idx);
+    float glowRadius = 0.5 / u_Zoom;
+    vec2 ppos = READ_PARTICLE_POS(idx);
+    vec2 halfWorld = vec2(u_WorldWidth, u_WorldHeight) * 0.5;
+
+    bool visible = mass >= 0.01;
+    if ((image & 1) != 0) {
+        visible = visible && abs(ppos.x) > halfWorld.x - glowRadius;
+        ppos.x -= sign(ppos.x) * u_WorldWidth;
+    }
+    if ((image & 2) != 0) {
+        visible = visible && abs(ppos.y) > halfWorld.y - glowRadius;
+        ppos.y -= sign(ppos.y) * u_WorldHeight;
+    }
+
+    if (!visible) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+    vOffset = corner * glowRadius;
+    vWorldPos = ppos + vOffset;
+    vColor = speciesColor(READ_PARTICLE_SPECIES(idx), mass);
+    vEnergy = mass;
+
+    
+    float windowAspect = u_WindowWidth / u_WindowHeight;
+    float worldAspect = u_WorldWidth / u_WorldHeight;
+    vec2 aspectScale = vec2(1.0);
+    if (windowAspect > worldAspect) {
+        aspectScale.x = windowAspect / worldAspect;
+    } else {
+        aspectScale.y = worldAspect / windowAspect;
+    }
+
+    vec2 scaledUV = (vWorldPos - vec2(u_TranslateX, u_TranslateY)) * u_Zoom /
+                    (vec2(u_WorldWidth, u_WorldHeight) * 0.5);
+    gl_Position = vec4(scaledUV / aspectScale, 0.0, 1.0);
+}
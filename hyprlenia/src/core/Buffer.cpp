@@ -1,8 +1,23 @@
 #include "Buffer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
+namespace {
+
+std::atomic<uint64_t> g_bytesRead{0};
+std::atomic<int64_t> g_bytesAllocated{0};
+
+}  // namespace
+
+uint64_t Buffer::bytesRead() { return g_bytesRead.load(); }
+
+int64_t Buffer::bytesAllocated() { return g_bytesAllocated.load(); }
+
+void Buffer::countRead(uint64_t bytes) { g_bytesRead += bytes; }
+
 Buffer::Buffer()
     : m_id(0),
       m_count(0),
@@ -14,6 +29,28 @@ Buffer::Buffer(int count, GLenum type)
 
 Buffer::~Buffer() { cleanup(); }
 
+Buffer::Buffer(Buffer&& other) noexcept
+    : m_id(other.m_id),
+      m_count(other.m_count),
+      m_type(other.m_type),
+      m_initialized(other.m_initialized) {
+  other.m_id = 0;
+  other.m_initialized = false;
+}
+
+Buffer& Buffer::operator=(Buffer&& other) noexcept {
+  if (this != &other) {
+    cleanup();
+    m_id = other.m_id;
+    m_count = other.m_count;
+    m_type = other.m_type;
+    m_initialized = other.m_initialized;
+    other.m_id = 0;
+    other.m_initialized = false;
+  }
+  return *this;
+}
+
 void Buffer::init() {
   if (m_initialized) return;
 
@@ -21,6 +58,7 @@ void Buffer::init() {
   glBindBuffer(m_type, m_id);
   glBufferData(m_type, sizeof(float) * m_count, nullptr, GL_DYNAMIC_DRAW);
   glBindBuffer(m_type, 0);
+  g_bytesAllocated += sizeof(float) * m_count;
 
   m_initialized = true;
 }
@@ -28,6 +66,7 @@ void Buffer::init() {
 void Buffer::cleanup() {
   if (m_initialized && m_id != 0) {
     glDeleteBuffers(1, &m_id);
+    g_bytesAllocated -= sizeof(float) * m_count;
     m_id = 0;
     m_initialized = false;
   }
@@ -54,10 +93,62 @@ std::vector<float> Buffer::getData() const {
   std::vector<float> data(m_count);
   glBindBuffer(m_type, m_id);
   glGetBufferSubData(m_type, 0, m_count * sizeof(float), data.data());
+  g_bytesRead += m_count * sizeof(float);
   glBindBuffer(m_type, 0);
   return data;
 }
 
+std::vector<float> Buffer::getData(int offset, int count) const {
+  std::vector<float> data(count);
+  glBindBuffer(m_type, m_id);
+  glGetBufferSubData(m_type, offset * sizeof(float), count * sizeof(float),
+                     data.data());
+  g_bytesRead += count * sizeof(float);
+  glBindBuffer(m_type, 0);
+  return data;
+}
+
+void Buffer::clear() {
+  glBindBuffer(m_type, m_id);
+  glClearBufferData(m_type, GL_R32F, GL_RED, GL_FLOAT, nullptr);
+  glBindBuffer(m_type, 0);
+}
+
+// Reallocates to count floats, copying the surviving prefix GPU-side and
+// zeroing any new tail.
+void Buffer::resize(int count) {
+  if (!m_initialized) {
+    m_count = count;
+    init();
+    clear();
+    return;
+  }
+  if (count == m_count) return;
+
+  GLuint newId = 0;
+  glGenBuffers(1, &newId);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, newId);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeof(float) * count, nullptr,
+               GL_DYNAMIC_DRAW);
+
+  int kept = std::min(count, m_count);
+  glBindBuffer(GL_COPY_READ_BUFFER, m_id);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                      sizeof(float) * kept);
+  if (count > kept) {
+    glClearBufferSubData(GL_COPY_WRITE_BUFFER, GL_R32F, sizeof(float) * kept,
+                         sizeof(float) * (count - kept), GL_RED, GL_FLOAT,
+                         nullptr);
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glDeleteBuffers(1, &m_id);
+  g_bytesAllocated += static_cast<int64_t>(sizeof(float)) * (count - m_count);
+  m_id = newId;
+  m_count = count;
+}
+
 void Buffer::bind(GLuint index) const { glBindBufferBase(m_type, index, m_id); }
 
 void Buffer::unbind() const { glBindBuffer(m_type, 0); }
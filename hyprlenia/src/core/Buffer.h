@@ -3,6 +3,7 @@
 
 #include <glad/glad.h>
 
+#include <cstdint>
 #include <vector>
 
 class Buffer {
@@ -11,11 +12,21 @@ class Buffer {
   Buffer(int count, GLenum type);
   ~Buffer();
 
+  // A Buffer owns its GL object: moving hands it over, and assigning over
+  // an initialised Buffer deletes the old one.
+  Buffer(Buffer&& other) noexcept;
+  Buffer& operator=(Buffer&& other) noexcept;
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+
   void init();
   void cleanup();
 
   void setData(const std::vector<float>& data);
   std::vector<float> getData() const;
+  std::vector<float> getData(int offset, int count) const;
+  void clear();
+  void resize(int count);
 
   void bind(GLuint index) const;
   void unbind() const;
@@ -23,6 +34,13 @@ class Buffer {
   GLuint getId() const { return m_id; }
   int getCount() const { return m_count; }
 
+  // Running totals over every Buffer: bytes copied back by getData() and
+  // bytes currently allocated. Readbacks done without a Buffer can be added
+  // with countRead().
+  static uint64_t bytesRead();
+  static int64_t bytesAllocated();
+  static void countRead(uint64_t bytes);
+
  private:
   GLuint m_id;
   int m_count;
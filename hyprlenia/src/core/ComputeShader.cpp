@@ -7,7 +7,14 @@ ComputeShader::ComputeShader() : Shader(), m_path("") {}
 ComputeShader::ComputeShader(const std::string& path)
     : Shader(), m_path(path) {}
 
+ComputeShader::ComputeShader(const std::string& path,
+                             const std::vector<std::string>& defines)
+    : Shader(), m_path(path), m_defines(defines) {}
+
 void ComputeShader::init() {
+  std::string key = programKey({m_path}, m_defines);
+  if (acquireProgram(key)) return;
+
   std::string source = readFile(m_path);
   if (source.empty()) {
     std::cerr << "ERROR: Failed to load compute shader: " << m_path
@@ -15,12 +22,14 @@ void ComputeShader::init() {
     return;
   }
 
-  GLuint shader = compileShader(GL_COMPUTE_SHADER, source);
+  GLuint shader =
+      compileShader(GL_COMPUTE_SHADER, injectDefines(source, m_defines));
 
   m_id = glCreateProgram();
   glAttachShader(m_id, shader);
   glLinkProgram(m_id);
   checkLinkErrors(m_id);
+  shareProgram(key);
 
   glDeleteShader(shader);
 }
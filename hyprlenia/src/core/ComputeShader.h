@@ -8,6 +8,8 @@ class ComputeShader : public Shader {
  public:
   ComputeShader();
   explicit ComputeShader(const std::string& path);
+  ComputeShader(const std::string& path,
+                const std::vector<std::string>& defines);
 
   void init();
   void dispatch(GLuint x, GLuint y, GLuint z) const;
@@ -18,6 +20,7 @@ class ComputeShader : public Shader {
 
  private:
   std::string m_path;
+  std::vector<std::string> m_defines;
 };
 
 #endif  
@@ -0,0 +1,80 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer() : enabled(false), m_current(0) {}
+
+GpuTimer::~GpuTimer() { cleanup(); }
+
+void GpuTimer::cleanup() {
+  for (Frame& f : m_frames) {
+    if (!f.pool.empty()) {
+      glDeleteQueries(static_cast<GLsizei>(f.pool.size()), f.pool.data());
+    }
+    f = Frame();
+  }
+}
+
+int GpuTimer::passIndex(const std::string& pass) {
+  for (size_t i = 0; i < m_passes.size(); i++) {
+    if (m_passes[i] == pass) return static_cast<int>(i);
+  }
+  m_passes.push_back(pass);
+  m_milliseconds.push_back(0.0);
+  return static_cast<int>(m_passes.size()) - 1;
+}
+
+GLuint GpuTimer::nextQuery(Frame& f) {
+  if (f.used == static_cast<int>(f.pool.size())) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    f.pool.push_back(query);
+  }
+  return f.pool[f.used++];
+}
+
+void GpuTimer::begin(const std::string& pass) {
+  if (!enabled) return;
+  Frame& f = m_frames[m_current];
+  GLuint start = nextQuery(f);
+  glQueryCounter(start, GL_TIMESTAMP);
+  f.spans.push_back({passIndex(pass), start, 0});
+}
+
+void GpuTimer::end(const std::string& pass) {
+  if (!enabled) return;
+  Frame& f = m_frames[m_current];
+  int index = passIndex(pass);
+  for (auto it = f.spans.rbegin(); it != f.spans.rend(); ++it) {
+    if (it->pass == index && it->stop == 0) {
+      it->stop = nextQuery(f);
+      glQueryCounter(it->stop, GL_TIMESTAMP);
+      return;
+    }
+  }
+}
+
+void GpuTimer::frame() {
+  if (!enabled) return;
+  m_current = (m_current + 1) % FRAMES;
+  Frame& oldest = m_frames[m_current];
+  if (oldest.spans.empty()) return;
+
+  // Timestamps land in order, so the last query written says whether the
+  // whole frame is in. If it is not, the frame is dropped rather than waited
+  // for.
+  GLint ready = 0;
+  glGetQueryObjectiv(oldest.pool[oldest.used - 1], GL_QUERY_RESULT_AVAILABLE,
+                     &ready);
+  if (ready) {
+    std::vector<double> totals(m_passes.size(), 0.0);
+    for (const Span& span : oldest.spans) {
+      if (span.stop == 0) continue;
+      GLuint64 start = 0, stop = 0;
+      glGetQueryObjectui64v(span.start, GL_QUERY_RESULT, &start);
+      glGetQueryObjectui64v(span.stop, GL_QUERY_RESULT, &stop);
+      if (stop > start) totals[span.pass] += (stop - start) / 1.0e6;
+    }
+    m_milliseconds = totals;
+  }
+  oldest.used = 0;
+  oldest.spans.clear();
+}
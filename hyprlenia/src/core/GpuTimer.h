@@ -0,0 +1,55 @@
+#ifndef CHRONOS_GPU_TIMER_H
+#define CHRONOS_GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// GPU time per named pass, measured with GL_TIMESTAMP query pairs so passes
+// may nest. Results are read a few frames late, and only once the GPU has
+// them, so timing never stalls the pipeline. Does nothing unless enabled.
+class GpuTimer {
+ public:
+  GpuTimer();
+  ~GpuTimer();
+
+  void begin(const std::string& pass);
+  void end(const std::string& pass);
+
+  // Closes the current frame and collects the oldest one if it is ready.
+  void frame();
+
+  // Milliseconds per pass over the last collected frame, summed over every
+  // begin/end pair it had. Passes line up with passes().
+  const std::vector<std::string>& passes() const { return m_passes; }
+  const std::vector<double>& milliseconds() const { return m_milliseconds; }
+
+  void cleanup();
+
+  bool enabled;
+
+ private:
+  static constexpr int FRAMES = 4;
+
+  struct Span {
+    int pass;
+    GLuint start;
+    GLuint stop;  // 0 until end()
+  };
+  struct Frame {
+    std::vector<GLuint> pool;
+    int used = 0;
+    std::vector<Span> spans;
+  };
+
+  int passIndex(const std::string& pass);
+  GLuint nextQuery(Frame& f);
+
+  std::vector<std::string> m_passes;
+  std::vector<double> m_milliseconds;
+  Frame m_frames[FRAMES];
+  int m_current;
+};
+
+#endif  
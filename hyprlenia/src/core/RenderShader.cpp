@@ -19,28 +19,44 @@ RenderShader::RenderShader(const std::string& vertexPath,
       m_vbo(0),
       m_ebo(0) {}
 
-void RenderShader::init() {
-  
-  std::string vertexSource = readFile(m_vertexPath);
-  std::string fragmentSource = readFile(m_fragmentPath);
+RenderShader::RenderShader(const std::string& vertexPath,
+                           const std::string& fragmentPath,
+                           const std::vector<std::string>& defines)
+    : Shader(),
+      m_vertexPath(vertexPath),
+      m_fragmentPath(fragmentPath),
+      m_defines(defines),
+      m_vao(0),
+      m_vbo(0),
+      m_ebo(0) {}
 
-  if (vertexSource.empty() || fragmentSource.empty()) {
-    std::cerr << "ERROR: Failed to load render shaders" << std::endl;
-    return;
+void RenderShader::init() {
+  std::string key = programKey({m_vertexPath, m_fragmentPath}, m_defines);
+  if (!acquireProgram(key)) {
+    std::string vertexSource = readFile(m_vertexPath);
+    std::string fragmentSource = readFile(m_fragmentPath);
+
+    if (vertexSource.empty() || fragmentSource.empty()) {
+      std::cerr << "ERROR: Failed to load render shaders" << std::endl;
+      return;
+    }
+
+    GLuint vertexShader =
+        compileShader(GL_VERTEX_SHADER, injectDefines(vertexSource, m_defines));
+    GLuint fragmentShader = compileShader(
+        GL_FRAGMENT_SHADER, injectDefines(fragmentSource, m_defines));
+
+    m_id = glCreateProgram();
+    glAttachShader(m_id, vertexShader);
+    glAttachShader(m_id, fragmentShader);
+    glLinkProgram(m_id);
+    checkLinkErrors(m_id);
+    shareProgram(key);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
   }
 
-  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
-
-  m_id = glCreateProgram();
-  glAttachShader(m_id, vertexShader);
-  glAttachShader(m_id, fragmentShader);
-  glLinkProgram(m_id);
-  checkLinkErrors(m_id);
-
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-
   
   float vertices[] = {
                       1.0f, 1.0f,  0.0f, 1.0f,  1.0f,  1.0f, -1.0f,
@@ -8,6 +8,8 @@ class RenderShader : public Shader {
  public:
   RenderShader();
   RenderShader(const std::string& vertexPath, const std::string& fragmentPath);
+  RenderShader(const std::string& vertexPath, const std::string& fragmentPath,
+               const std::vector<std::string>& defines);
 
   void init();
   void render() const;
@@ -18,6 +20,7 @@ class RenderShader : public Shader {
  private:
   std::string m_vertexPath;
   std::string m_fragmentPath;
+  std::vector<std::string> m_defines;
 
   GLuint m_vao;
   GLuint m_vbo;
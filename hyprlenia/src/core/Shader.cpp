@@ -3,13 +3,76 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
+
+namespace {
+
+std::unordered_map<GLuint, int>& programUsers() {
+  static std::unordered_map<GLuint, int> users;
+  return users;
+}
+
+std::unordered_map<std::string, GLuint>& programsByKey() {
+  static std::unordered_map<std::string, GLuint> programs;
+  return programs;
+}
+
+}  // namespace
 
 Shader::Shader() : m_id(0) {}
 
-Shader::~Shader() {
-  if (m_id != 0) {
-    glDeleteProgram(m_id);
+Shader::~Shader() { releaseProgram(); }
+
+Shader::Shader(Shader&& other) noexcept : m_id(other.m_id) { other.m_id = 0; }
+
+Shader& Shader::operator=(Shader&& other) noexcept {
+  if (this != &other) {
+    releaseProgram();
+    m_id = other.m_id;
+    other.m_id = 0;
+  }
+  return *this;
+}
+
+void Shader::releaseProgram() {
+  if (m_id == 0) return;
+  GLuint id = m_id;
+  m_id = 0;
+  auto users = programUsers().find(id);
+  if (users != programUsers().end() && --users->second > 0) return;
+  if (users != programUsers().end()) {
+    programUsers().erase(users);
+    for (auto it = programsByKey().begin(); it != programsByKey().end(); ++it) {
+      if (it->second == id) {
+        programsByKey().erase(it);
+        break;
+      }
+    }
   }
+  glDeleteProgram(id);
+}
+
+bool Shader::acquireProgram(const std::string& key) {
+  // Initialising again drops the program from the last init().
+  releaseProgram();
+  auto it = programsByKey().find(key);
+  if (it == programsByKey().end()) return false;
+  m_id = it->second;
+  programUsers()[m_id]++;
+  return true;
+}
+
+void Shader::shareProgram(const std::string& key) {
+  programsByKey()[key] = m_id;
+  programUsers()[m_id] = 1;
+}
+
+std::string Shader::programKey(const std::vector<std::string>& paths,
+                               const std::vector<std::string>& defines) {
+  std::string key;
+  for (const std::string& path : paths) key += path + "|";
+  for (const std::string& define : defines) key += "#" + define;
+  return key;
 }
 
 void Shader::use() const { glUseProgram(m_id); }
@@ -71,6 +134,24 @@ std::string Shader::readFile(const std::string& path) {
   }
 }
 
+// GLSL requires #version first, so defines go on the line after it.
+std::string Shader::injectDefines(const std::string& source,
+                                  const std::vector<std::string>& defines) {
+  if (defines.empty()) return source;
+
+  std::string block;
+  for (const std::string& define : defines) {
+    block += "#define " + define + "\n";
+  }
+
+  size_t version = source.find("#version");
+  size_t lineEnd = version == std::string::npos
+                       ? std::string::npos
+                       : source.find('\n', version);
+  if (lineEnd == std::string::npos) return block + source;
+  return source.substr(0, lineEnd + 1) + block + source.substr(lineEnd + 1);
+}
+
 GLuint Shader::compileShader(GLenum type, const std::string& source) {
   GLuint shader = glCreateShader(type);
   const char* src = source.c_str();
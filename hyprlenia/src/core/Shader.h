@@ -5,12 +5,20 @@
 
 #include <array>
 #include <string>
+#include <vector>
 
 class Shader {
  public:
   Shader();
   virtual ~Shader();
 
+  // A Shader holds one reference to its shared program: moving hands it
+  // over, and assigning over a Shader releases the old one.
+  Shader(Shader&& other) noexcept;
+  Shader& operator=(Shader&& other) noexcept;
+  Shader(const Shader&) = delete;
+  Shader& operator=(const Shader&) = delete;
+
   GLuint getId() const { return m_id; }
 
   void use() const;
@@ -32,7 +40,18 @@ class Shader {
  protected:
   GLuint m_id;
 
+  // Programs are shared by every shader built from the same sources and
+  // defines, so a second simulation instance links nothing new. The last
+  // shader holding a program deletes it.
+  bool acquireProgram(const std::string& key);
+  void shareProgram(const std::string& key);
+  void releaseProgram();
+  static std::string programKey(const std::vector<std::string>& paths,
+                                const std::vector<std::string>& defines);
+
   std::string readFile(const std::string& path);
+  static std::string injectDefines(const std::string& source,
+                                   const std::vector<std::string>& defines);
   GLuint compileShader(GLenum type, const std::string& source);
   void checkCompileErrors(GLuint shader, const std::string& type);
   void checkLinkErrors(GLuint program);
@@ -0,0 +1,50 @@
+#ifndef CHRONOS_SHADER_PERMUTATIONS_H
+#define CHRONOS_SHADER_PERMUTATIONS_H
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Compiled variants of one shader source, keyed by the set of #defines they
+// were built with. Each variant is compiled the first time it is asked for
+// and kept for the lifetime of the cache.
+template <typename ShaderT>
+class ShaderPermutations {
+ public:
+  using Factory = std::function<ShaderT(const std::vector<std::string>&)>;
+
+  ShaderPermutations() = default;
+  explicit ShaderPermutations(Factory factory) : m_factory(factory) {}
+
+  ShaderT& get(const std::vector<std::string>& defines) {
+    std::string key = makeKey(defines);
+    auto it = m_variants.find(key);
+    if (it != m_variants.end()) return *it->second;
+
+    auto shader = std::make_unique<ShaderT>(m_factory(defines));
+    shader->init();
+    ShaderT& result = *shader;
+    m_variants.emplace(key, std::move(shader));
+    return result;
+  }
+
+  size_t size() const { return m_variants.size(); }
+  void clear() { m_variants.clear(); }
+
+ private:
+  // Define order does not change the program, so the key is order-free.
+  static std::string makeKey(std::vector<std::string> defines) {
+    std::sort(defines.begin(), defines.end());
+    std::string key;
+    for (const std::string& define : defines) key += define + ";";
+    return key;
+  }
+
+  Factory m_factory;
+  std::map<std::string, std::unique_ptr<ShaderT>> m_variants;
+};
+
+#endif  
@@ -0,0 +1,358 @@
+#include "ChunkStore.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <string>
+
+#if defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int STRIDE = 15;
+constexpr size_t HEADER_BYTES = 2 * sizeof(uint32_t);
+constexpr size_t INITIAL_CAPACITY = size_t(1) << 20;
+
+// Packs a byte stream as runs: a control byte below 128 is followed by that
+// many plus one literal bytes; 128 and above repeats the next byte
+// (control - 125) times.
+void packRuns(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+  size_t i = 0;
+  size_t literalStart = 0;
+  auto flushLiterals = [&](size_t end) {
+    while (literalStart < end) {
+      size_t n = std::min<size_t>(128, end - literalStart);
+      out.push_back(static_cast<uint8_t>(n - 1));
+      out.insert(out.end(), in.begin() + literalStart,
+                 in.begin() + literalStart + n);
+      literalStart += n;
+    }
+  };
+  while (i < in.size()) {
+    size_t run = 1;
+    while (i + run < in.size() && in[i + run] == in[i] && run < 130) run++;
+    if (run >= 3) {
+      flushLiterals(i);
+      out.push_back(static_cast<uint8_t>(run + 125));
+      out.push_back(in[i]);
+      i += run;
+      literalStart = i;
+    } else {
+      i += run;
+    }
+  }
+  flushLiterals(in.size());
+}
+
+void unpackRuns(const uint8_t* in, size_t bytes, std::vector<uint8_t>& out) {
+  size_t i = 0;
+  while (i < bytes) {
+    uint8_t control = in[i++];
+    if (control < 128) {
+      out.insert(out.end(), in + i, in + i + control + 1);
+      i += control + 1;
+    } else {
+      out.insert(out.end(), static_cast<size_t>(control - 125), in[i++]);
+    }
+  }
+}
+
+// Particles are sorted by x and split into byte planes of each field, XORed
+// with the previous particle's field. Neighbouring particles share sign,
+// exponent and high mantissa bits, and constant fields vanish entirely, so
+// the upper planes become long zero runs.
+std::vector<uint8_t> encodeBlock(const float* particles, int count) {
+  std::vector<int> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return particles[a * STRIDE] < particles[b * STRIDE];
+  });
+
+  std::vector<uint8_t> planes(static_cast<size_t>(count) * STRIDE * 4);
+  size_t k = 0;
+  for (int f = 0; f < STRIDE; f++) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      uint32_t previous = 0;
+      for (int i = 0; i < count; i++) {
+        uint32_t bits;
+        std::memcpy(&bits, &particles[order[i] * STRIDE + f], sizeof(bits));
+        planes[k++] = static_cast<uint8_t>((bits ^ previous) >> shift);
+        previous = bits;
+      }
+    }
+  }
+
+  std::vector<uint8_t> out(HEADER_BYTES);
+  packRuns(planes, out);
+  uint32_t header[2] = {static_cast<uint32_t>(count),
+                        static_cast<uint32_t>(out.size() - HEADER_BYTES)};
+  std::memcpy(out.data(), header, HEADER_BYTES);
+  return out;
+}
+
+// Decodes consecutive blocks and appends the particles to out.
+void decodeBlocks(const uint8_t* data, size_t bytes, std::vector<float>& out) {
+  std::vector<uint8_t> planes;
+  size_t pos = 0;
+  while (pos + HEADER_BYTES <= bytes) {
+    uint32_t header[2];
+    std::memcpy(header, data + pos, HEADER_BYTES);
+    int count = static_cast<int>(header[0]);
+    planes.clear();
+    unpackRuns(data + pos + HEADER_BYTES, header[1], planes);
+    pos += HEADER_BYTES + header[1];
+
+    size_t base = out.size();
+    out.resize(base + static_cast<size_t>(count) * STRIDE);
+    size_t k = 0;
+    for (int f = 0; f < STRIDE; f++) {
+      std::vector<uint32_t> bits(count, 0);
+      for (int shift = 24; shift >= 0; shift -= 8) {
+        for (int i = 0; i < count; i++) {
+          bits[i] |= static_cast<uint32_t>(planes[k++]) << shift;
+        }
+      }
+      uint32_t previous = 0;
+      for (int i = 0; i < count; i++) {
+        previous ^= bits[i];
+        std::memcpy(&out[base + static_cast<size_t>(i) * STRIDE + f],
+                    &previous, sizeof(previous));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+ChunkStore::ChunkStore()
+    : m_base(nullptr),
+      m_capacity(0),
+      m_used(0),
+      m_live(0),
+      m_file(-1),
+      m_hits(0),
+      m_misses(0),
+      m_stop(false) {
+  m_worker = std::thread(&ChunkStore::run, this);
+}
+
+ChunkStore::~ChunkStore() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  m_worker.join();
+#if defined(__unix__)
+  if (m_file >= 0) {
+    munmap(m_base, m_capacity);
+    close(m_file);
+  }
+#endif
+}
+
+// Grows the mapping to hold at least `bytes`. The scratch file is unlinked as
+// soon as it is created, so nothing is left behind on exit.
+void ChunkStore::reserve(size_t bytes) {
+  if (bytes <= m_capacity) return;
+  size_t capacity = std::max(m_capacity, INITIAL_CAPACITY);
+  while (capacity < bytes) capacity *= 2;
+
+#if defined(__unix__)
+  if (m_file < 0 && m_capacity == 0) {
+    const char* dir = std::getenv("TMPDIR");
+    std::string path = std::string(dir ? dir : "/tmp") + "/chronos_chunksXXXXXX";
+    m_file = mkstemp(path.data());
+    if (m_file >= 0) unlink(path.c_str());
+  }
+  if (m_file >= 0) {
+    void* mapping = MAP_FAILED;
+    if (ftruncate(m_file, static_cast<off_t>(capacity)) == 0) {
+      mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     m_file, 0);
+    }
+    if (mapping != MAP_FAILED) {
+      if (m_base) munmap(m_base, m_capacity);
+      m_base = static_cast<uint8_t*>(mapping);
+      m_capacity = capacity;
+      return;
+    }
+    std::cerr << "Chunk store: cannot grow scratch file, using memory"
+              << std::endl;
+    if (m_base) {
+      m_heap.assign(m_base, m_base + m_used);
+      munmap(m_base, m_capacity);
+    }
+    close(m_file);
+    m_file = -1;
+  }
+#endif
+
+  m_heap.resize(capacity);
+  m_base = m_heap.data();
+  m_capacity = capacity;
+}
+
+// Slides live blocks down over the space freed by take().
+void ChunkStore::compact() {
+  std::vector<Block*> blocks;
+  for (Chunk& chunk : m_chunks) {
+    for (Block& block : chunk.blocks) blocks.push_back(&block);
+  }
+  std::sort(blocks.begin(), blocks.end(),
+            [](const Block* a, const Block* b) { return a->offset < b->offset; });
+  size_t end = 0;
+  for (Block* block : blocks) {
+    if (block->offset != end) {
+      std::memmove(m_base + end, m_base + block->offset, block->bytes);
+      block->offset = end;
+    }
+    end += block->bytes;
+  }
+  m_used = end;
+}
+
+std::vector<uint8_t> ChunkStore::blockBytes(const Chunk& chunk) const {
+  std::vector<uint8_t> bytes;
+  for (const Block& block : chunk.blocks) {
+    bytes.insert(bytes.end(), m_base + block.offset,
+                 m_base + block.offset + block.bytes);
+  }
+  return bytes;
+}
+
+void ChunkStore::reset(int chunkCount) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_chunks.assign(std::max(chunkCount, 0), Chunk());
+  m_decoded.clear();
+  m_queue.clear();
+  m_used = 0;
+  m_live = 0;
+  m_hits = 0;
+  m_misses = 0;
+}
+
+void ChunkStore::store(int chunk, const float* particles, int count) {
+  if (count <= 0) return;
+  std::vector<uint8_t> block = encodeBlock(particles, count);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (chunk < 0 || chunk >= static_cast<int>(m_chunks.size())) return;
+  if (m_used - m_live > m_live && m_used > INITIAL_CAPACITY) compact();
+  reserve(m_used + block.size());
+  std::memcpy(m_base + m_used, block.data(), block.size());
+
+  Chunk& c = m_chunks[chunk];
+  c.blocks.push_back({m_used, block.size(), count});
+  c.count += count;
+  c.version++;
+  m_used += block.size();
+  m_live += block.size();
+}
+
+int ChunkStore::take(int chunk, std::vector<float>& out) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (chunk < 0 || chunk >= static_cast<int>(m_chunks.size())) return 0;
+  Chunk& c = m_chunks[chunk];
+  int count = c.count;
+  if (count == 0) return 0;
+
+  auto decoded = m_decoded.find(chunk);
+  std::vector<float> ready;
+  std::vector<uint8_t> bytes;
+  if (decoded != m_decoded.end() && decoded->second.version == c.version) {
+    ready.swap(decoded->second.particles);
+    m_hits++;
+  } else {
+    bytes = blockBytes(c);
+    m_misses++;
+  }
+  if (decoded != m_decoded.end()) m_decoded.erase(decoded);
+
+  for (const Block& block : c.blocks) m_live -= block.bytes;
+  c.blocks.clear();
+  c.count = 0;
+  c.version++;
+  lock.unlock();
+
+  if (!bytes.empty()) decodeBlocks(bytes.data(), bytes.size(), ready);
+  out.insert(out.end(), ready.begin(), ready.end());
+  return count;
+}
+
+void ChunkStore::prefetch(const std::vector<int>& chunks) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_decoded.begin(); it != m_decoded.end();) {
+      bool wanted =
+          std::find(chunks.begin(), chunks.end(), it->first) != chunks.end();
+      it = wanted ? std::next(it) : m_decoded.erase(it);
+    }
+    m_queue = chunks;
+  }
+  m_wake.notify_one();
+}
+
+void ChunkStore::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_wake.wait(lock, [&] { return m_stop || !m_queue.empty(); });
+    if (m_stop) return;
+
+    int chunk = m_queue.back();
+    m_queue.pop_back();
+    if (chunk < 0 || chunk >= static_cast<int>(m_chunks.size())) continue;
+    const Chunk& c = m_chunks[chunk];
+    auto decoded = m_decoded.find(chunk);
+    if (c.count == 0 ||
+        (decoded != m_decoded.end() && decoded->second.version == c.version)) {
+      continue;
+    }
+
+    int version = c.version;
+    std::vector<uint8_t> bytes = blockBytes(c);
+    lock.unlock();
+    std::vector<float> particles;
+    decodeBlocks(bytes.data(), bytes.size(), particles);
+    lock.lock();
+
+    // The chunk may have been stored to or taken while decoding.
+    if (chunk < static_cast<int>(m_chunks.size()) &&
+        m_chunks[chunk].version == version) {
+      m_decoded[chunk] = {version, std::move(particles)};
+    }
+  }
+}
+
+int ChunkStore::chunkCount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return static_cast<int>(m_chunks.size());
+}
+
+int ChunkStore::storedCount(int chunk) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (chunk < 0 || chunk >= static_cast<int>(m_chunks.size())) return 0;
+  return m_chunks[chunk].count;
+}
+
+int64_t ChunkStore::totalStored() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  int64_t total = 0;
+  for (const Chunk& chunk : m_chunks) total += chunk.count;
+  return total;
+}
+
+size_t ChunkStore::compressedBytes() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_live;
+}
+
+size_t ChunkStore::mappedBytes() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_capacity;
+}
@@ -0,0 +1,85 @@
+#ifndef CHRONOS_CHUNK_STORE_H
+#define CHRONOS_CHUNK_STORE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Holds the particles of paged-out world chunks, compressed, in a scratch
+// file mapped into memory. Each store() appends one compressed block to a
+// chunk; take() decodes and removes all of them. prefetch() decodes chunks
+// on a worker thread so a later take() only has to copy.
+class ChunkStore {
+ public:
+  ChunkStore();
+  ~ChunkStore();
+
+  ChunkStore(const ChunkStore&) = delete;
+  ChunkStore& operator=(const ChunkStore&) = delete;
+
+  // Drops every stored particle and sets the number of chunks.
+  void reset(int chunkCount);
+
+  // Appends count particles (stride 15) to the chunk's stored set.
+  void store(int chunk, const float* particles, int count);
+
+  // Appends the chunk's stored particles to out and removes them from the
+  // store. Returns how many there were.
+  int take(int chunk, std::vector<float>& out);
+
+  // Replaces the prefetch queue. Decoded chunks not in the list are dropped.
+  void prefetch(const std::vector<int>& chunks);
+
+  int chunkCount() const;
+  int storedCount(int chunk) const;
+  int64_t totalStored() const;
+  size_t compressedBytes() const;
+  size_t mappedBytes() const;
+  int prefetchHits() const { return m_hits; }
+  int prefetchMisses() const { return m_misses; }
+
+ private:
+  struct Block {
+    size_t offset;
+    size_t bytes;
+    int count;
+  };
+  struct Chunk {
+    std::vector<Block> blocks;
+    int count = 0;
+    int version = 0;
+  };
+  struct Decoded {
+    int version;
+    std::vector<float> particles;
+  };
+
+  void reserve(size_t bytes);
+  void compact();
+  std::vector<uint8_t> blockBytes(const Chunk& chunk) const;
+  void run();
+
+  mutable std::mutex m_mutex;
+  std::vector<Chunk> m_chunks;
+  uint8_t* m_base;
+  size_t m_capacity;
+  size_t m_used;
+  size_t m_live;
+  int m_file;
+  std::vector<uint8_t> m_heap;
+
+  std::unordered_map<int, Decoded> m_decoded;
+  std::vector<int> m_queue;
+  int m_hits;
+  int m_misses;
+
+  std::thread m_worker;
+  std::condition_variable m_wake;
+  bool m_stop;
+};
+
+#endif  
@@ -0,0 +1,526 @@
+#include "ControlSocket.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t QUEUE_SLOTS = 256;
+constexpr size_t MAX_LINE = 1 << 20;
+constexpr size_t MAX_CLIENTS = 32;
+
+std::string escape(const std::string& s) {
+  std::string out = "\"";
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (c < 0x20) {
+          char code[8];
+          std::snprintf(code, sizeof(code), "\\u%04x", c);
+          out += code;
+        } else {
+          out += static_cast<char>(c);
+        }
+    }
+  }
+  return out + "\"";
+}
+
+void appendUtf8(std::string& out, unsigned code) {
+  if (code < 0x80) {
+    out += static_cast<char>(code);
+  } else if (code < 0x800) {
+    out += static_cast<char>(0xc0 | (code >> 6));
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  } else {
+    out += static_cast<char>(0xe0 | (code >> 12));
+    out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  }
+}
+
+void skipSpace(const std::string& s, size_t& at) {
+  while (at < s.size() && std::isspace(static_cast<unsigned char>(s[at]))) {
+    at++;
+  }
+}
+
+bool parseString(const std::string& s, size_t& at, std::string& out) {
+  if (at >= s.size() || s[at] != '"') return false;
+  at++;
+  out.clear();
+  while (at < s.size() && s[at] != '"') {
+    char c = s[at++];
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+    if (at >= s.size()) return false;
+    char e = s[at++];
+    switch (e) {
+      case 'n':
+        out += '\n';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'u': {
+        if (at + 4 > s.size()) return false;
+        char* end = nullptr;
+        std::string hex = s.substr(at, 4);
+        unsigned code = std::strtoul(hex.c_str(), &end, 16);
+        if (end != hex.c_str() + 4) return false;
+        appendUtf8(out, code);
+        at += 4;
+        break;
+      }
+      default:
+        out += e;
+    }
+  }
+  if (at >= s.size()) return false;
+  at++;
+  return true;
+}
+
+}  // namespace
+
+std::string ControlRequest::text(const std::string& key,
+                                 const std::string& fallback) const {
+  auto it = fields.find(key);
+  return it == fields.end() ? fallback : it->second;
+}
+
+double ControlRequest::number(const std::string& key, double fallback) const {
+  auto it = fields.find(key);
+  if (it == fields.end()) return fallback;
+  char* end = nullptr;
+  double value = std::strtod(it->second.c_str(), &end);
+  return end != it->second.c_str() && *end == '\0' ? value : fallback;
+}
+
+bool ControlRequest::flag(const std::string& key, bool fallback) const {
+  auto it = fields.find(key);
+  if (it == fields.end()) return fallback;
+  if (it->second == "true") return true;
+  if (it->second == "false") return false;
+  return number(key, fallback ? 1.0 : 0.0) != 0.0;
+}
+
+JsonObject& JsonObject::number(const std::string& key, double value) {
+  if (!std::isfinite(value)) return raw(key, "null");
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.9g", value);
+  return raw(key, text);
+}
+
+JsonObject& JsonObject::integer(const std::string& key, int64_t value) {
+  return raw(key, std::to_string(value));
+}
+
+JsonObject& JsonObject::boolean(const std::string& key, bool value) {
+  return raw(key, value ? "true" : "false");
+}
+
+JsonObject& JsonObject::string(const std::string& key,
+                               const std::string& value) {
+  return raw(key, escape(value));
+}
+
+JsonObject& JsonObject::value(const std::string& key,
+                              const std::string& text) {
+  if (text == "true" || text == "false" || text == "null") {
+    return raw(key, text);
+  }
+  char* end = nullptr;
+  std::strtod(text.c_str(), &end);
+  bool numeric = !text.empty() && *end == '\0' &&
+                 text.find_first_of("xXnN") == std::string::npos;
+  return numeric ? raw(key, text) : string(key, text);
+}
+
+JsonObject& JsonObject::raw(const std::string& key, const std::string& value) {
+  if (!m_body.empty()) m_body += ",";
+  m_body += escape(key) + ":" + value;
+  return *this;
+}
+
+bool parseJsonObject(const std::string& line,
+                     std::map<std::string, std::string>& fields,
+                     std::string& error) {
+  fields.clear();
+  size_t at = 0;
+  skipSpace(line, at);
+  if (at >= line.size() || line[at] != '{') {
+    error = "expected a JSON object";
+    return false;
+  }
+  at++;
+  skipSpace(line, at);
+  if (at < line.size() && line[at] == '}') {
+    at++;
+  } else {
+    while (true) {
+      std::string key, value;
+      skipSpace(line, at);
+      if (!parseString(line, at, key)) {
+        error = "expected a string key";
+        return false;
+      }
+      skipSpace(line, at);
+      if (at >= line.size() || line[at] != ':') {
+        error = "expected ':' after \"" + key + "\"";
+        return false;
+      }
+      at++;
+      skipSpace(line, at);
+      if (at < line.size() && line[at] == '"') {
+        if (!parseString(line, at, value)) {
+          error = "unterminated string for \"" + key + "\"";
+          return false;
+        }
+      } else if (at < line.size() && (line[at] == '{' || line[at] == '[')) {
+        error = "nested values are not supported (\"" + key + "\")";
+        return false;
+      } else {
+        size_t start = at;
+        while (at < line.size() && line[at] != ',' && line[at] != '}' &&
+               !std::isspace(static_cast<unsigned char>(line[at]))) {
+          at++;
+        }
+        value = line.substr(start, at - start);
+        if (value.empty()) {
+          error = "missing value for \"" + key + "\"";
+          return false;
+        }
+      }
+      fields[key] = value;
+      skipSpace(line, at);
+      if (at < line.size() && line[at] == ',') {
+        at++;
+        continue;
+      }
+      if (at < line.size() && line[at] == '}') {
+        at++;
+        break;
+      }
+      error = "expected ',' or '}'";
+      return false;
+    }
+  }
+  skipSpace(line, at);
+  if (at != line.size()) {
+    error = "trailing characters after the object";
+    return false;
+  }
+  return true;
+}
+
+ControlSocket::ControlSocket()
+    : m_listenFd(-1),
+      m_wakeFds{-1, -1},
+      m_stop(false),
+      m_requests(QUEUE_SLOTS),
+      m_replies(QUEUE_SLOTS) {}
+
+ControlSocket::~ControlSocket() { stop(); }
+
+bool ControlSocket::next(ControlRequest& request) {
+  flushReplies();
+  return m_requests.pop(request);
+}
+
+void ControlSocket::reply(ControlReply&& reply) {
+  m_overflow.push_back(std::move(reply));
+  flushReplies();
+  notify();
+}
+
+void ControlSocket::flushReplies() {
+  while (!m_overflow.empty() && m_replies.push(std::move(m_overflow.front()))) {
+    m_overflow.pop_front();
+  }
+}
+
+#if defined(__unix__)
+
+bool ControlSocket::start(const std::string& path,
+                          std::function<void()> wake) {
+  stop();
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Control socket path is empty or too long: " << path
+              << std::endl;
+    return false;
+  }
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (m_listenFd < 0 || pipe2(m_wakeFds, O_NONBLOCK | O_CLOEXEC) != 0) {
+    std::cerr << "Control socket: " << std::strerror(errno) << std::endl;
+    stop();
+    return false;
+  }
+  // Only a stale socket file is removed; anything else at path is an error.
+  struct stat existing;
+  if (lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+    unlink(path.c_str());
+  }
+  if (bind(m_listenFd, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(m_listenFd, 8) != 0) {
+    std::cerr << "Control socket " << path << ": " << std::strerror(errno)
+              << std::endl;
+    stop();
+    return false;
+  }
+
+  m_path = path;
+  m_wake = std::move(wake);
+  m_stop = false;
+  m_thread = std::thread(&ControlSocket::serve, this);
+  std::cout << "Control socket listening on " << path << std::endl;
+  return true;
+}
+
+void ControlSocket::stop() {
+  m_stop = true;
+  notify();
+  if (m_thread.joinable()) m_thread.join();
+  for (int& fd : m_wakeFds) {
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+  if (m_listenFd >= 0) {
+    close(m_listenFd);
+    m_listenFd = -1;
+    if (!m_path.empty()) unlink(m_path.c_str());
+  }
+  m_path.clear();
+}
+
+void ControlSocket::notify() {
+  if (m_wakeFds[1] >= 0) {
+    char byte = 1;
+    ssize_t ignored = write(m_wakeFds[1], &byte, 1);
+    (void)ignored;
+  }
+}
+
+void ControlSocket::serve() {
+  struct Client {
+    uint64_t id;
+    int fd;
+    std::string in;
+    std::string out;
+    bool closed = false;
+  };
+  std::vector<Client> clients;
+  uint64_t nextId = 1;
+
+  while (!m_stop) {
+    std::vector<pollfd> fds = {{m_listenFd, POLLIN, 0},
+                               {m_wakeFds[0], POLLIN, 0}};
+    for (const Client& c : clients) {
+      short events = POLLIN;
+      if (!c.out.empty()) events |= POLLOUT;
+      fds.push_back({c.fd, events, 0});
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) break;
+    if (m_stop) break;
+
+    if (fds[1].revents & POLLIN) {
+      char drain[64];
+      while (read(m_wakeFds[0], drain, sizeof(drain)) > 0) {
+      }
+    }
+
+    ControlReply reply;
+    while (m_replies.pop(reply)) {
+      for (Client& c : clients) {
+        if (c.id != reply.client) continue;
+        c.out += reply.line;
+        c.out += '\n';
+        c.out.append(reply.payload.begin(), reply.payload.end());
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept4(m_listenFd, nullptr, nullptr,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (clients.size() >= MAX_CLIENTS) {
+          close(fd);
+          continue;
+        }
+        clients.push_back({nextId++, fd, "", ""});
+      }
+    }
+
+    bool queued = false;
+    for (size_t i = 0; i < clients.size(); i++) {
+      Client& c = clients[i];
+      short revents = i + 2 < fds.size() && fds[i + 2].fd == c.fd
+                          ? fds[i + 2].revents
+                          : 0;
+      if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        char buffer[4096];
+        while (true) {
+          ssize_t n = read(c.fd, buffer, sizeof(buffer));
+          if (n > 0) {
+            c.in.append(buffer, n);
+          } else if (n < 0 && errno == EINTR) {
+            continue;
+          } else {
+            if (n == 0 || errno != EAGAIN) c.closed = true;
+            break;
+          }
+        }
+
+        size_t end;
+        while ((end = c.in.find('\n')) != std::string::npos) {
+          std::string line = c.in.substr(0, end);
+          c.in.erase(0, end + 1);
+          if (!line.empty() && line.back() == '\r') line.pop_back();
+          if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+          ControlRequest request;
+          request.client = c.id;
+          std::string error;
+          if (!parseJsonObject(line, request.fields, error)) {
+            c.out += JsonObject().boolean("ok", false).string("error", error)
+                         .str() + "\n";
+            continue;
+          }
+          std::string id = request.text("id");
+          if (m_requests.push(std::move(request))) {
+            queued = true;
+          } else {
+            JsonObject busy;
+            busy.boolean("ok", false).string("error", "busy");
+            if (!id.empty()) busy.value("id", id);
+            c.out += busy.str() + "\n";
+          }
+        }
+        if (c.in.size() > MAX_LINE) {
+          c.out += JsonObject().boolean("ok", false)
+                       .string("error", "line too long").str() + "\n";
+          c.in.clear();
+          c.closed = true;
+        }
+      }
+
+      while (!c.out.empty()) {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+          c.out.erase(0, n);
+        } else {
+          if (n < 0 && errno != EAGAIN && errno != EINTR) c.closed = true;
+          break;
+        }
+      }
+    }
+    if (queued && m_wake) m_wake();
+
+    for (size_t i = 0; i < clients.size();) {
+      if (clients[i].closed) {
+        close(clients[i].fd);
+        clients.erase(clients.begin() + i);
+      } else {
+        i++;
+      }
+    }
+  }
+
+  for (Client& c : clients) close(c.fd);
+}
+
+bool ControlSocket::writeSharedMemory(const std::string& name,
+                                      const void* data, size_t bytes,
+                                      std::string& error) {
+  if (name.size() < 2 || name[0] != '/' ||
+      name.find('/', 1) != std::string::npos) {
+    error = "shared memory names look like \"/name\"";
+    return false;
+  }
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+  if (fd < 0) {
+    error = std::strerror(errno);
+    return false;
+  }
+  bool ok = ftruncate(fd, static_cast<off_t>(bytes)) == 0;
+  if (ok && bytes > 0) {
+    void* map = mmap(nullptr, bytes, PROT_WRITE, MAP_SHARED, fd, 0);
+    ok = map != MAP_FAILED;
+    if (ok) {
+      std::memcpy(map, data, bytes);
+      munmap(map, bytes);
+    }
+  }
+  if (!ok) error = std::strerror(errno);
+  close(fd);
+  return ok;
+}
+
+#else
+
+bool ControlSocket::start(const std::string& path,
+                          std::function<void()> wake) {
+  std::cerr << "The control socket needs a Unix-like system" << std::endl;
+  return false;
+}
+
+void ControlSocket::stop() {}
+
+void ControlSocket::notify() {}
+
+void ControlSocket::serve() {}
+
+bool ControlSocket::writeSharedMemory(const std::string& name,
+                                      const void* data, size_t bytes,
+                                      std::string& error) {
+  error = "shared memory needs a Unix-like system";
+  return false;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef CHRONOS_CONTROL_SOCKET_H
+#define CHRONOS_CONTROL_SOCKET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed-size ring for exactly one producer thread and one consumer thread.
+// Neither side locks or waits; push() fails when the ring is full.
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity) : m_slots(capacity + 1) {}
+
+  bool push(T&& value) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t next = (tail + 1) % m_slots.size();
+    if (next == m_head.load(std::memory_order_acquire)) return false;
+    m_slots[tail] = std::move(value);
+    m_tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& value) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) return false;
+    value = std::move(m_slots[head]);
+    m_head.store((head + 1) % m_slots.size(), std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::vector<T> m_slots;
+  alignas(64) std::atomic<size_t> m_head{0};
+  alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+// One request line, a flat JSON object. Strings are unescaped; numbers,
+// true, false and null are kept as written.
+struct ControlRequest {
+  uint64_t client = 0;
+  std::map<std::string, std::string> fields;
+
+  bool has(const std::string& key) const { return fields.count(key) > 0; }
+  std::string text(const std::string& key,
+                   const std::string& fallback = "") const;
+  double number(const std::string& key, double fallback) const;
+  bool flag(const std::string& key, bool fallback) const;
+};
+
+struct ControlReply {
+  uint64_t client = 0;
+  std::string line;           // one JSON object, without the newline
+  std::vector<char> payload;  // raw bytes sent straight after the line
+};
+
+// Builds a flat JSON object for a reply line.
+class JsonObject {
+ public:
+  JsonObject& number(const std::string& key, double value);
+  JsonObject& integer(const std::string& key, int64_t value);
+  JsonObject& boolean(const std::string& key, bool value);
+  JsonObject& string(const std::string& key, const std::string& value);
+  // As a number or literal when text reads as one, otherwise a string.
+  JsonObject& value(const std::string& key, const std::string& text);
+  // value must already be valid JSON.
+  JsonObject& raw(const std::string& key, const std::string& value);
+  std::string str() const { return "{" + m_body + "}"; }
+
+ private:
+  std::string m_body;
+};
+
+// False, with error set, unless line is a flat JSON object.
+bool parseJsonObject(const std::string& line,
+                     std::map<std::string, std::string>& fields,
+                     std::string& error);
+
+// Line-delimited JSON over a Unix-domain stream socket. A background thread
+// accepts clients, splits and parses their lines and queues the requests;
+// the main thread takes them with next() between frames and answers with
+// reply(), which the background thread writes out. Neither thread waits on
+// the other: a full request queue is answered "busy" straight away, as are
+// lines that do not parse, so those replies can overtake earlier ones.
+class ControlSocket {
+ public:
+  ControlSocket();
+  ~ControlSocket();
+
+  // Binds path, replacing a stale socket file, and starts serving. wake is
+  // called from the background thread after requests are queued.
+  bool start(const std::string& path, std::function<void()> wake = nullptr);
+  void stop();
+  bool running() const { return m_thread.joinable(); }
+  const std::string& path() const { return m_path; }
+
+  bool next(ControlRequest& request);
+  void reply(ControlReply&& reply);
+
+  // Copies bytes into the POSIX shared memory object `name` ("/..."),
+  // creating or resizing it.
+  static bool writeSharedMemory(const std::string& name, const void* data,
+                                size_t bytes, std::string& error);
+
+ private:
+  void serve();
+  void flushReplies();
+  void notify();
+
+  std::string m_path;
+  int m_listenFd;
+  int m_wakeFds[2];
+  std::atomic<bool> m_stop;
+  std::function<void()> m_wake;
+  std::thread m_thread;
+  SpscQueue<ControlRequest> m_requests;
+  SpscQueue<ControlReply> m_replies;
+  // Replies the ring had no room for; main thread only.
+  std::deque<ControlReply> m_overflow;
+};
+
+#endif  
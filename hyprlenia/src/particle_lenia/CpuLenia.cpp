@@ -0,0 +1,137 @@
+#include "CpuLenia.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SpatialHash.h"
+
+namespace {
+
+constexpr int STRIDE = 15;
+
+float wrapDelta(float d, float size) {
+  if (d > size * 0.5f) return d - size;
+  if (d < -size * 0.5f) return d + size;
+  return d;
+}
+
+float wrapCoord(float p, float size) {
+  float half = size * 0.5f;
+  float m = std::fmod(p + half, size);
+  if (m < 0.0f) m += size;
+  return m - half;
+}
+
+std::vector<int> neighbourCells(int cell, int cells) {
+  std::vector<int> out;
+  for (int o = -1; o <= 1; o++) {
+    int c = ((cell + o) % cells + cells) % cells;
+    if (std::find(out.begin(), out.end(), c) == out.end()) out.push_back(c);
+  }
+  return out;
+}
+
+}  // namespace
+
+CpuLenia::CpuLenia(const CpuLeniaParams& params) : m_params(params) {}
+
+float CpuLenia::interactionRadius() const {
+  return m_params.mu_k + 3.0f * std::sqrt(m_params.sigma_k2) + m_params.h;
+}
+
+void CpuLenia::step(const std::vector<float>& particles,
+                    const std::vector<int>& ids, int owned,
+                    std::vector<float>& out) const {
+  const CpuLeniaParams& p = m_params;
+  const float* world = p.worldSize;
+  int count = static_cast<int>(ids.size());
+  int dims = p.planar ? 2 : 3;
+  int stencil = 1 + 2 * dims;
+  float radius = interactionRadius();
+
+  // Planar runs ignore z, so they bin into a single layer.
+  SpatialHash grid;
+  grid.build(particles, count, STRIDE, radius, world[0], world[1],
+             p.planar ? radius : world[2]);
+  const int* cells = grid.getCells();
+  const std::vector<int>& cellParticles = grid.getParticles();
+
+  auto kernelK = [&](float r) {
+    float diff = r - p.mu_k;
+    return p.w_k * std::exp(-diff * diff / p.sigma_k2);
+  };
+  auto repulsion = [&](float r) {
+    if (r <= 0.0001f || r >= 1.0f) return 0.0f;
+    float proximity = 1.0f - r;
+    return 0.5f * p.c_rep * proximity * proximity;
+  };
+  auto energy = [&](float U, float R) {
+    float diff = U - p.mu_g;
+    return R - std::exp(-diff * diff / p.sigma_g2);
+  };
+
+  out.assign(static_cast<size_t>(owned) * STRIDE, 0.0f);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < owned; i++) {
+    const float* me = &particles[static_cast<size_t>(i) * STRIDE];
+    float* result = &out[static_cast<size_t>(i) * STRIDE];
+    std::copy(me, me + STRIDE, result);
+    if (me[6] < 0.01f) continue;
+
+    std::vector<std::pair<int, int>> partners;
+    int cell[3];
+    grid.cellOf(me, cell);
+    for (int z : neighbourCells(cell[2], cells[2])) {
+      for (int y : neighbourCells(cell[1], cells[1])) {
+        for (int x : neighbourCells(cell[0], cells[0])) {
+          int begin, end;
+          grid.cellRange(x, y, z, begin, end);
+          for (int k = begin; k < end; k++) {
+            int j = cellParticles[k];
+            const float* other = &particles[static_cast<size_t>(j) * STRIDE];
+            float d2 = 0.0f;
+            for (int a = 0; a < dims; a++) {
+              float d = wrapDelta(other[a] - me[a], world[a]);
+              d2 += d * d;
+            }
+            if (d2 < radius * radius) partners.push_back({ids[j], j});
+          }
+        }
+      }
+    }
+    std::sort(partners.begin(), partners.end());
+
+    float U[7] = {0.0f}, R[7] = {0.0f};
+    for (const auto& partner : partners) {
+      const float* other =
+          &particles[static_cast<size_t>(partner.second) * STRIDE];
+      for (int q = 0; q < stencil; q++) {
+        float d2 = 0.0f;
+        for (int a = 0; a < dims; a++) {
+          float query = me[a];
+          if (q > 0 && (q - 1) / 2 == a) query += (q % 2 == 1) ? p.h : -p.h;
+          float d = wrapDelta(other[a] - query, world[a]);
+          d2 += d * d;
+        }
+        float dist = std::sqrt(d2);
+        U[q] += kernelK(dist);
+        R[q] += repulsion(dist);
+      }
+    }
+
+    float pos[3] = {me[0], me[1], me[2]};
+    for (int a = 0; a < dims; a++) {
+      float gradE = (energy(U[1 + 2 * a], R[1 + 2 * a]) -
+                     energy(U[2 + 2 * a], R[2 + 2 * a])) /
+                    (2.0f * p.h);
+      pos[a] = wrapCoord(pos[a] - p.dt * gradE, world[a]);
+    }
+    for (int a = 0; a < 3; a++) {
+      result[a] = pos[a];
+      result[3 + a] = (pos[a] - me[a]) / std::max(p.dt, 0.001f);
+    }
+    result[8] = me[8] + 1.0f;
+    result[14] = U[0];
+  }
+}
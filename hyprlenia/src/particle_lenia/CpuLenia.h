@@ -0,0 +1,41 @@
+#ifndef CHRONOS_CPU_LENIA_H
+#define CHRONOS_CPU_LENIA_H
+
+#include <vector>
+
+struct CpuLeniaParams {
+  float w_k = 0.022f;
+  float mu_k = 4.0f;
+  float sigma_k2 = 1.0f;
+  float mu_g = 0.6f;
+  float sigma_g2 = 0.0225f;
+  float c_rep = 1.0f;
+  float dt = 0.1f;
+  float h = 0.01f;
+  float worldSize[3] = {40.0f, 40.0f, 40.0f};
+  bool planar = false;
+};
+
+// CPU version of the step kernel's core dynamics (no evolution, food or
+// goal): gradient descent on E = R - G(U) with the same central-difference
+// stencil and periodic wrap. Partners are limited to the kernel cutoff and
+// summed in ascending id order, so a particle's result depends only on which
+// particles are near it, not on how they are stored.
+class CpuLenia {
+ public:
+  explicit CpuLenia(const CpuLeniaParams& params);
+
+  // Distance beyond which particles cannot affect one another's step.
+  float interactionRadius() const;
+
+  // Advances the first `owned` particles of `particles` (stride 15); the
+  // rest are read-only halo. `ids` names every particle and fixes the
+  // summation order. Writes owned * 15 floats to `out`.
+  void step(const std::vector<float>& particles, const std::vector<int>& ids,
+            int owned, std::vector<float>& out) const;
+
+ private:
+  CpuLeniaParams m_params;
+};
+
+#endif  
@@ -0,0 +1,220 @@
+#include "DomainDecomposition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__unix__)
+#include <omp.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int STRIDE = 15;
+constexpr int MAX_RANKS = 64;
+
+struct Record {
+  int32_t id;
+  float data[STRIDE];
+};
+
+// Start of the shared mapping. Each rank's mailbox of `capacity` records
+// follows it.
+struct SharedHeader {
+#if defined(__unix__)
+  pthread_barrier_t barrier;
+#endif
+  int failed;
+  int counts[MAX_RANKS];
+  int owned[MAX_RANKS];
+  int halo[MAX_RANKS];
+  float bounds[MAX_RANKS + 1];
+};
+
+float positiveMod(float v, float size) {
+  float m = std::fmod(v, size);
+  return m < 0.0f ? m + size : m;
+}
+
+}  // namespace
+
+DomainDecomposition::DomainDecomposition(const CpuLeniaParams& params,
+                                         int ranks, int rebalanceEvery)
+    : m_params(params),
+      m_ranks(std::clamp(ranks, 1, MAX_RANKS)),
+      m_rebalanceEvery(rebalanceEvery) {}
+
+#if defined(__unix__)
+
+bool DomainDecomposition::run(std::vector<float>& particles, int count,
+                              int steps) {
+  const int ranks = m_ranks;
+  const float width = m_params.worldSize[0];
+  const float radius = CpuLenia(m_params).interactionRadius();
+
+  std::vector<int> alive;
+  for (int i = 0; i < count; i++) {
+    if (particles[static_cast<size_t>(i) * STRIDE + 6] >= 0.01f) {
+      alive.push_back(i);
+    }
+  }
+  const size_t capacity = std::max<size_t>(alive.size(), 1);
+
+  size_t bytes = sizeof(SharedHeader) + ranks * capacity * sizeof(Record);
+  void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Domain decomposition: cannot map shared memory" << std::endl;
+    return false;
+  }
+  SharedHeader* header = static_cast<SharedHeader*>(mapping);
+  Record* mailboxes = reinterpret_cast<Record*>(header + 1);
+  header->failed = 0;
+
+  pthread_barrierattr_t attr;
+  pthread_barrierattr_init(&attr);
+  pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_barrier_init(&header->barrier, &attr, ranks);
+  pthread_barrierattr_destroy(&attr);
+
+  auto rankMain = [&](int rank) {
+    omp_set_num_threads(std::max(1, omp_get_num_procs() / ranks));
+    CpuLenia engine(m_params);
+    Record* mailbox = mailboxes + rank * capacity;
+
+    // Slabs start equal-width; rank r begins with every ranks-th particle
+    // and the first exchange sends each to its slab's owner.
+    std::vector<Record> mine;
+    for (size_t k = rank; k < alive.size(); k += ranks) {
+      Record rec;
+      rec.id = alive[k];
+      std::copy_n(&particles[static_cast<size_t>(alive[k]) * STRIDE], STRIDE,
+                  rec.data);
+      mine.push_back(rec);
+    }
+    std::vector<float> bounds(ranks + 1);
+    for (int r = 0; r <= ranks; r++) {
+      bounds[r] = -width * 0.5f + width * r / ranks;
+    }
+
+    auto publish = [&]() {
+      std::copy(mine.begin(), mine.end(), mailbox);
+      header->counts[rank] = static_cast<int>(mine.size());
+      pthread_barrier_wait(&header->barrier);
+    };
+
+    std::vector<Record> owned, halo;
+    std::vector<float> local, next;
+    std::vector<int> ids;
+    for (int step = 0; step < steps; step++) {
+      publish();
+
+      if (m_rebalanceEvery > 0 && step % m_rebalanceEvery == 0) {
+        std::vector<float> xs;
+        for (int r = 0; r < ranks; r++) {
+          for (int k = 0; k < header->counts[r]; k++) {
+            xs.push_back(mailboxes[r * capacity + k].data[0]);
+          }
+        }
+        std::sort(xs.begin(), xs.end());
+        for (int r = 1; r < ranks && !xs.empty(); r++) {
+          size_t split = std::min(xs.size() - 1, xs.size() * r / ranks);
+          bounds[r] = split == 0 ? xs[0] : 0.5f * (xs[split - 1] + xs[split]);
+        }
+      }
+
+      // Owned: inside [lo, hi). Halo: within the interaction radius of the
+      // slab along x, measured around the periodic seam.
+      float lo = bounds[rank];
+      float hi = bounds[rank + 1];
+      owned.clear();
+      halo.clear();
+      for (int r = 0; r < ranks; r++) {
+        for (int k = 0; k < header->counts[r]; k++) {
+          const Record& rec = mailboxes[r * capacity + k];
+          float x = rec.data[0];
+          if (x >= lo && x < hi) {
+            owned.push_back(rec);
+          } else if (std::min(positiveMod(lo - x, width),
+                              positiveMod(x - hi, width)) < radius) {
+            halo.push_back(rec);
+          }
+        }
+      }
+      pthread_barrier_wait(&header->barrier);
+
+      local.clear();
+      ids.clear();
+      for (const std::vector<Record>* part : {&owned, &halo}) {
+        for (const Record& rec : *part) {
+          local.insert(local.end(), rec.data, rec.data + STRIDE);
+          ids.push_back(rec.id);
+        }
+      }
+      engine.step(local, ids, static_cast<int>(owned.size()), next);
+
+      mine = owned;
+      for (size_t k = 0; k < mine.size(); k++) {
+        std::copy_n(&next[k * STRIDE], STRIDE, mine[k].data);
+      }
+      header->owned[rank] = static_cast<int>(owned.size());
+      header->halo[rank] = static_cast<int>(halo.size());
+      if (rank == 0) std::copy(bounds.begin(), bounds.end(), header->bounds);
+    }
+    publish();
+  };
+
+  std::vector<pid_t> children;
+  for (int rank = 0; rank < ranks; rank++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      rankMain(rank);
+      _exit(0);
+    }
+    if (pid < 0) {
+      // A missing rank would leave the others waiting at the barrier.
+      std::cerr << "Domain decomposition: fork failed" << std::endl;
+      for (pid_t child : children) kill(child, SIGKILL);
+      header->failed = 1;
+      break;
+    }
+    children.push_back(pid);
+  }
+  for (pid_t child : children) {
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) header->failed = 1;
+  }
+
+  bool ok = header->failed == 0;
+  if (ok) {
+    for (int r = 0; r < ranks; r++) {
+      for (int k = 0; k < header->counts[r]; k++) {
+        const Record& rec = mailboxes[r * capacity + k];
+        std::copy_n(rec.data, STRIDE,
+                    &particles[static_cast<size_t>(rec.id) * STRIDE]);
+      }
+    }
+    m_stats.bounds.assign(header->bounds, header->bounds + ranks + 1);
+    m_stats.owned.assign(header->owned, header->owned + ranks);
+    m_stats.halo.assign(header->halo, header->halo + ranks);
+  }
+
+  pthread_barrier_destroy(&header->barrier);
+  munmap(mapping, bytes);
+  return ok;
+}
+
+#else
+
+bool DomainDecomposition::run(std::vector<float>&, int, int) {
+  std::cerr << "Domain decomposition needs a POSIX system" << std::endl;
+  return false;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CHRONOS_DOMAIN_DECOMPOSITION_H
+#define CHRONOS_DOMAIN_DECOMPOSITION_H
+
+#include <vector>
+
+#include "CpuLenia.h"
+
+// Runs CpuLenia across several processes, each owning one x slab of the
+// periodic world. Every step the ranks publish their particles to shared
+// memory; each then takes the particles inside its slab as owned and those
+// within the interaction radius of it as halo, so crossing particles migrate
+// and halos are exchanged in the same pass. Every rebalanceEvery steps the
+// slab boundaries move to equal-count quantiles of x. Results match a
+// single-process CpuLenia run bit for bit.
+class DomainDecomposition {
+ public:
+  struct Stats {
+    std::vector<float> bounds;
+    std::vector<int> owned;
+    std::vector<int> halo;
+  };
+
+  DomainDecomposition(const CpuLeniaParams& params, int ranks,
+                      int rebalanceEvery);
+
+  // Advances `count` particles (stride 15) in place. Returns false when the
+  // worker processes could not be started or one of them failed.
+  bool run(std::vector<float>& particles, int count, int steps);
+
+  const Stats& getStats() const { return m_stats; }
+
+ private:
+  CpuLeniaParams m_params;
+  int m_ranks;
+  int m_rebalanceEvery;
+  Stats m_stats;
+};
+
+#endif  
@@ -0,0 +1,407 @@
+#include "GoalImage.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+// Source image as one luminance value per pixel, row 0 at the top.
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<float> luma;
+};
+
+uint32_t readU16(const std::vector<unsigned char>& b, size_t at) {
+  return b[at] | (b[at + 1] << 8);
+}
+
+uint32_t readU32(const std::vector<unsigned char>& b, size_t at) {
+  return b[at] | (b[at + 1] << 8) | (b[at + 2] << 16) |
+         (static_cast<uint32_t>(b[at + 3]) << 24);
+}
+
+float pixelLuma(const unsigned char* bgr) {
+  return (bgr[0] + bgr[1] + bgr[2]) / (3.0f * 255.0f);
+}
+
+bool sizeOk(int width, int height, std::string& error) {
+  if (width <= 0 || height <= 0 || width > 32768 || height > 32768) {
+    error = "unsupported image size";
+    return false;
+  }
+  return true;
+}
+
+// Uncompressed 8-bit palettised, 24-bit and 32-bit BMP with any header
+// version; negative heights are top-down.
+bool decodeBMP(const std::vector<unsigned char>& b, Image& img,
+               std::string& error) {
+  if (b.size() < 54) {
+    error = "truncated BMP header";
+    return false;
+  }
+  uint32_t dataPos = readU32(b, 10);
+  uint32_t headerSize = readU32(b, 14);
+  int width = static_cast<int32_t>(readU32(b, 18));
+  int height = static_cast<int32_t>(readU32(b, 22));
+  int bpp = readU16(b, 28);
+  uint32_t compression = readU32(b, 30);
+  bool topDown = height < 0;
+  height = std::abs(height);
+  if (!sizeOk(width, height, error)) return false;
+  if (compression != 0 && !(compression == 3 && bpp == 32)) {
+    error = "compressed BMP not supported";
+    return false;
+  }
+  if (bpp != 8 && bpp != 24 && bpp != 32) {
+    error = "unsupported BMP bit depth " + std::to_string(bpp);
+    return false;
+  }
+
+  std::vector<float> palette;
+  if (bpp == 8) {
+    uint32_t colours = readU32(b, 46);
+    if (colours == 0 || colours > 256) colours = 256;
+    size_t paletteAt = 14 + headerSize;
+    if (paletteAt + colours * 4 > b.size()) {
+      error = "truncated BMP palette";
+      return false;
+    }
+    palette.resize(256, 0.0f);
+    for (uint32_t c = 0; c < colours; c++) {
+      palette[c] = pixelLuma(&b[paletteAt + c * 4]);
+    }
+  }
+
+  size_t stride = ((static_cast<size_t>(bpp) * width + 31) / 32) * 4;
+  if (dataPos + stride * height > b.size()) {
+    error = "truncated BMP pixel data";
+    return false;
+  }
+
+  img.width = width;
+  img.height = height;
+  img.luma.resize(static_cast<size_t>(width) * height);
+  int bytes = bpp / 8;
+#pragma omp parallel for
+  for (int y = 0; y < height; y++) {
+    int srcRow = topDown ? y : height - 1 - y;
+    const unsigned char* row = &b[dataPos + stride * srcRow];
+    float* dst = &img.luma[static_cast<size_t>(y) * width];
+    for (int x = 0; x < width; x++) {
+      dst[x] = bpp == 8 ? palette[row[x]] : pixelLuma(row + x * bytes);
+    }
+  }
+  return true;
+}
+
+// Next whitespace-separated PNM header token, skipping '#' comments.
+bool pnmToken(const std::vector<unsigned char>& b, size_t& at, int& value) {
+  while (at < b.size()) {
+    if (b[at] == '#') {
+      while (at < b.size() && b[at] != '\n') at++;
+    } else if (std::isspace(b[at])) {
+      at++;
+    } else {
+      break;
+    }
+  }
+  if (at >= b.size() || !std::isdigit(b[at])) return false;
+  value = 0;
+  while (at < b.size() && std::isdigit(b[at])) {
+    value = value * 10 + (b[at] - '0');
+    at++;
+  }
+  return true;
+}
+
+// P2/P5 greymaps and P3/P6 pixmaps, 8 or 16 bits per sample.
+bool decodePNM(const std::vector<unsigned char>& b, Image& img,
+               std::string& error) {
+  char kind = b[1];
+  int channels = (kind == '3' || kind == '6') ? 3 : 1;
+  bool ascii = kind == '2' || kind == '3';
+  size_t at = 2;
+  int width, height, maxVal;
+  if (!pnmToken(b, at, width) || !pnmToken(b, at, height) ||
+      !pnmToken(b, at, maxVal) || maxVal <= 0 || maxVal > 65535) {
+    error = "bad PNM header";
+    return false;
+  }
+  if (!sizeOk(width, height, error)) return false;
+
+  size_t samples = static_cast<size_t>(width) * height * channels;
+  std::vector<float> values(samples);
+  if (ascii) {
+    for (size_t s = 0; s < samples; s++) {
+      int v;
+      if (!pnmToken(b, at, v)) {
+        error = "truncated PNM data";
+        return false;
+      }
+      values[s] = v / static_cast<float>(maxVal);
+    }
+  } else {
+    at++;
+    int sampleBytes = maxVal > 255 ? 2 : 1;
+    if (at + samples * sampleBytes > b.size()) {
+      error = "truncated PNM data";
+      return false;
+    }
+    for (size_t s = 0; s < samples; s++) {
+      int v = sampleBytes == 2 ? (b[at + 2 * s] << 8) | b[at + 2 * s + 1]
+                               : b[at + s];
+      values[s] = v / static_cast<float>(maxVal);
+    }
+  }
+
+  img.width = width;
+  img.height = height;
+  img.luma.resize(static_cast<size_t>(width) * height);
+  for (size_t p = 0; p < img.luma.size(); p++) {
+    img.luma[p] = channels == 1 ? values[p]
+                                : (values[p * 3] + values[p * 3 + 1] +
+                                   values[p * 3 + 2]) / 3.0f;
+  }
+  return true;
+}
+
+// Truecolour and greyscale TGA (types 2, 3 and their RLE forms 10, 11).
+bool decodeTGA(const std::vector<unsigned char>& b, Image& img,
+               std::string& error) {
+  if (b.size() < 18) {
+    error = "truncated TGA header";
+    return false;
+  }
+  int type = b[2];
+  int width = readU16(b, 12);
+  int height = readU16(b, 14);
+  int bpp = b[16];
+  bool topDown = (b[17] & 0x20) != 0;
+  if (!sizeOk(width, height, error)) return false;
+  if (type != 2 && type != 3 && type != 10 && type != 11) {
+    error = "unsupported TGA type " + std::to_string(type);
+    return false;
+  }
+  if (bpp != 8 && bpp != 24 && bpp != 32) {
+    error = "unsupported TGA bit depth " + std::to_string(bpp);
+    return false;
+  }
+
+  size_t at = 18 + b[0];
+  if (b[1] == 1) at += readU16(b, 5) * ((b[7] + 7) / 8);
+  int bytes = bpp / 8;
+  size_t pixels = static_cast<size_t>(width) * height;
+  std::vector<float> values(pixels);
+  auto luma = [&](size_t from) {
+    return bytes == 1 ? b[from] / 255.0f : pixelLuma(&b[from]);
+  };
+
+  if (type == 2 || type == 3) {
+    if (at + pixels * bytes > b.size()) {
+      error = "truncated TGA data";
+      return false;
+    }
+    for (size_t p = 0; p < pixels; p++) values[p] = luma(at + p * bytes);
+  } else {
+    size_t p = 0;
+    while (p < pixels) {
+      if (at >= b.size()) {
+        error = "truncated TGA data";
+        return false;
+      }
+      int header = b[at++];
+      size_t run = std::min<size_t>((header & 0x7f) + 1, pixels - p);
+      bool packed = (header & 0x80) != 0;
+      size_t need = packed ? bytes : run * bytes;
+      if (at + need > b.size()) {
+        error = "truncated TGA data";
+        return false;
+      }
+      for (size_t r = 0; r < run; r++) {
+        values[p++] = luma(packed ? at : at + r * bytes);
+      }
+      at += need;
+    }
+  }
+
+  img.width = width;
+  img.height = height;
+  img.luma.resize(pixels);
+  for (int y = 0; y < height; y++) {
+    int srcRow = topDown ? y : height - 1 - y;
+    std::copy_n(&values[static_cast<size_t>(srcRow) * width], width,
+                &img.luma[static_cast<size_t>(y) * width]);
+  }
+  return true;
+}
+
+// Source pixels covered by each destination cell and their coverage weights,
+// normalised so a cell's weights sum to one.
+struct Footprint {
+  int begin;
+  std::vector<float> weights;
+};
+
+std::vector<Footprint> footprints(int src, int dst) {
+  std::vector<Footprint> result(dst);
+  double scale = static_cast<double>(src) / dst;
+  for (int d = 0; d < dst; d++) {
+    double lo = d * scale;
+    double hi = (d + 1) * scale;
+    int begin = std::min(static_cast<int>(lo), src - 1);
+    int end = std::min(static_cast<int>(std::ceil(hi)), src);
+    result[d].begin = begin;
+    for (int s = begin; s < std::max(end, begin + 1); s++) {
+      double cover = std::min(hi, s + 1.0) - std::max(lo, double(s));
+      result[d].weights.push_back(static_cast<float>(cover / (hi - lo)));
+    }
+  }
+  return result;
+}
+
+// Separable box filter: rows are reduced to the target width first, then
+// columns of that intermediate to the target height.
+void areaResample(const Image& img, int size, std::vector<float>& out) {
+  std::vector<Footprint> columns = footprints(img.width, size);
+  std::vector<Footprint> rows = footprints(img.height, size);
+  std::vector<float> narrow(static_cast<size_t>(img.height) * size);
+
+#pragma omp parallel for
+  for (int y = 0; y < img.height; y++) {
+    const float* src = &img.luma[static_cast<size_t>(y) * img.width];
+    float* dst = &narrow[static_cast<size_t>(y) * size];
+    for (int x = 0; x < size; x++) {
+      const Footprint& f = columns[x];
+      const float* from = src + f.begin;
+      const float* w = f.weights.data();
+      int n = static_cast<int>(f.weights.size());
+      float sum = 0.0f;
+#pragma omp simd reduction(+ : sum)
+      for (int k = 0; k < n; k++) sum += from[k] * w[k];
+      dst[x] = sum;
+    }
+  }
+
+  out.assign(static_cast<size_t>(size) * size, 0.0f);
+#pragma omp parallel for
+  for (int y = 0; y < size; y++) {
+    const Footprint& f = rows[size - 1 - y];
+    float* dst = &out[static_cast<size_t>(y) * size];
+    for (size_t k = 0; k < f.weights.size(); k++) {
+      const float* src = &narrow[static_cast<size_t>(f.begin + k) * size];
+      float w = f.weights[k];
+#pragma omp simd
+      for (int x = 0; x < size; x++) dst[x] += src[x] * w;
+    }
+  }
+}
+
+}  // namespace
+
+bool loadGoalImage(const std::string& path, int size, std::vector<float>& out,
+                   std::string& error) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    error = "cannot open file";
+    return false;
+  }
+  std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+  if (bytes.size() < 2) {
+    error = "file too short";
+    return false;
+  }
+
+  Image img;
+  bool ok;
+  if (bytes[0] == 'B' && bytes[1] == 'M') {
+    ok = decodeBMP(bytes, img, error);
+  } else if (bytes[0] == 'P' && bytes[1] >= '2' && bytes[1] <= '6' &&
+             bytes[1] != '4') {
+    ok = decodePNM(bytes, img, error);
+  } else {
+    ok = decodeTGA(bytes, img, error);
+  }
+  if (!ok) return false;
+
+  areaResample(img, size, out);
+  return true;
+}
+
+GoalImageLoader::GoalImageLoader()
+    : m_stop(false),
+      m_requested(0),
+      m_finished(0),
+      m_delivered(0),
+      m_size(0),
+      m_resultOk(false) {
+  m_worker = std::thread(&GoalImageLoader::run, this);
+}
+
+GoalImageLoader::~GoalImageLoader() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_worker.join();
+}
+
+void GoalImageLoader::request(const std::string& path, int size) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_size = size;
+    m_requested++;
+  }
+  m_wake.notify_one();
+}
+
+bool GoalImageLoader::poll(std::vector<float>& data, bool& ok,
+                           std::string& error) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_finished != m_requested || m_delivered == m_finished) return false;
+  m_delivered = m_finished;
+  data.swap(m_result);
+  ok = m_resultOk;
+  error = m_resultError;
+  return true;
+}
+
+bool GoalImageLoader::busy() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_finished != m_requested;
+}
+
+// Results of requests superseded while loading are dropped, so a burst of
+// requests costs at most one stale decode.
+void GoalImageLoader::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_wake.wait(lock, [&] { return m_stop || m_finished != m_requested; });
+    if (m_stop) return;
+
+    int generation = m_requested;
+    std::string path = m_path;
+    int size = m_size;
+    lock.unlock();
+
+    std::vector<float> data;
+    std::string error;
+    bool ok = loadGoalImage(path, size, data, error);
+
+    lock.lock();
+    if (generation == m_requested) {
+      m_result.swap(data);
+      m_resultOk = ok;
+      m_resultError = error;
+      m_finished = generation;
+    }
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef CHRONOS_GOAL_IMAGE_H
+#define CHRONOS_GOAL_IMAGE_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes a BMP, PGM/PPM or TGA file of any size and area-averages its
+// luminance onto a size x size grid in [0, 1], row 0 at the bottom.
+bool loadGoalImage(const std::string& path, int size, std::vector<float>& out,
+                   std::string& error);
+
+// Runs loadGoalImage on a worker thread. Only the newest request is kept;
+// poll() hands over its result once, from whichever thread owns the texture.
+class GoalImageLoader {
+ public:
+  GoalImageLoader();
+  ~GoalImageLoader();
+
+  void request(const std::string& path, int size);
+  bool poll(std::vector<float>& data, bool& ok, std::string& error);
+  bool busy() const;
+
+ private:
+  void run();
+
+  std::thread m_worker;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stop;
+  int m_requested;
+  int m_finished;
+  int m_delivered;
+  std::string m_path;
+  int m_size;
+  std::vector<float> m_result;
+  bool m_resultOk;
+  std::string m_resultError;
+};
+
+#endif  
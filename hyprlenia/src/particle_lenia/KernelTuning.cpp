@@ -0,0 +1,72 @@
+#include "KernelTuning.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+std::string entryKey(const std::string& driver, const std::string& workload) {
+  return driver + "\t" + workload;
+}
+
+}  // namespace
+
+KernelTuningCache::KernelTuningCache(const std::string& path) : m_path(path) {}
+
+// One entry per line: driver, workload, local size, particles per thread and
+// the measured milliseconds per step, separated by tabs.
+void KernelTuningCache::load() {
+  m_entries.clear();
+  std::ifstream in(m_path);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string driver, workload, localSize, perThread, milliseconds;
+    if (!std::getline(fields, driver, '\t') ||
+        !std::getline(fields, workload, '\t') ||
+        !std::getline(fields, localSize, '\t') ||
+        !std::getline(fields, perThread, '\t') ||
+        !std::getline(fields, milliseconds)) {
+      continue;
+    }
+    try {
+      m_entries[entryKey(driver, workload)] = {
+          std::stoi(localSize), std::stoi(perThread), std::stof(milliseconds)};
+    } catch (...) {
+      std::cerr << "Skipping bad kernel tuning entry: " << line << std::endl;
+    }
+  }
+}
+
+bool KernelTuningCache::find(const std::string& driver,
+                             const std::string& workload,
+                             Choice& choice) const {
+  auto it = m_entries.find(entryKey(driver, workload));
+  if (it == m_entries.end()) return false;
+  choice = it->second;
+  return true;
+}
+
+void KernelTuningCache::store(const std::string& driver,
+                              const std::string& workload,
+                              const Choice& choice) {
+  // Other caches on the same file (comparison panes, other processes) may
+  // have stored entries since this one loaded; keep them.
+  load();
+  m_entries[entryKey(driver, workload)] = choice;
+  save();
+}
+
+void KernelTuningCache::save() const {
+  std::ofstream out(m_path);
+  if (!out) {
+    std::cerr << "Failed to write kernel tuning to " << m_path << std::endl;
+    return;
+  }
+  for (const auto& entry : m_entries) {
+    out << entry.first << "\t" << entry.second.localSize << "\t"
+        << entry.second.particlesPerThread << "\t"
+        << entry.second.milliseconds << "\n";
+  }
+}
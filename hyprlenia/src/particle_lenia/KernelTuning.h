@@ -0,0 +1,33 @@
+#ifndef CHRONOS_KERNEL_TUNING_H
+#define CHRONOS_KERNEL_TUNING_H
+
+#include <map>
+#include <string>
+
+// Fastest step-kernel configuration found per driver and workload, kept in a
+// tab-separated text file so each machine pays for tuning only once.
+class KernelTuningCache {
+ public:
+  struct Choice {
+    int localSize;
+    int particlesPerThread;
+    float milliseconds;
+  };
+
+  explicit KernelTuningCache(const std::string& path);
+
+  void load();
+  bool find(const std::string& driver, const std::string& workload,
+            Choice& choice) const;
+  // Re-reads the file first, so the save keeps what others stored meanwhile.
+  void store(const std::string& driver, const std::string& workload,
+             const Choice& choice);
+
+ private:
+  void save() const;
+
+  std::string m_path;
+  std::map<std::string, Choice> m_entries;
+};
+
+#endif  
@@ -0,0 +1,245 @@
+#include "LeniaApi.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "CpuLenia.h"
+#include "SteadyState.h"
+
+namespace {
+
+constexpr int STRIDE = 15;
+
+// The part of a caller's struct that both sides know about. Fields past the
+// caller's size keep their defaults.
+constexpr size_t PARAMS_MIN_SIZE = offsetof(lenia_params, w_k);
+constexpr size_t VIEW_MIN_SIZE =
+    offsetof(lenia_particle_view, position_offset);
+
+CpuLeniaParams toCore(const lenia_params& in) {
+  CpuLeniaParams out;
+  out.w_k = in.w_k;
+  out.mu_k = in.mu_k;
+  out.sigma_k2 = in.sigma_k2;
+  out.mu_g = in.mu_g;
+  out.sigma_g2 = in.sigma_g2;
+  out.c_rep = in.c_rep;
+  out.dt = in.dt;
+  out.h = in.h;
+  std::copy(in.world_size, in.world_size + 3, out.worldSize);
+  out.planar = in.planar != 0;
+  return out;
+}
+
+lenia_params fromCore(const CpuLeniaParams& in) {
+  lenia_params out;
+  out.size = sizeof(lenia_params);
+  out.w_k = in.w_k;
+  out.mu_k = in.mu_k;
+  out.sigma_k2 = in.sigma_k2;
+  out.mu_g = in.mu_g;
+  out.sigma_g2 = in.sigma_g2;
+  out.c_rep = in.c_rep;
+  out.dt = in.dt;
+  out.h = in.h;
+  std::copy(in.worldSize, in.worldSize + 3, out.world_size);
+  out.planar = in.planar ? 1 : 0;
+  return out;
+}
+
+bool validParams(const CpuLeniaParams& p) {
+  return p.sigma_k2 > 0.0f && p.sigma_g2 > 0.0f && p.h > 0.0f &&
+         p.worldSize[0] > 0.0f && p.worldSize[1] > 0.0f &&
+         p.worldSize[2] > 0.0f;
+}
+
+// Copies the caller's struct over the defaults, up to whichever size is
+// smaller.
+bool readParams(const lenia_params* in, CpuLeniaParams& out) {
+  if (!in || in->size < PARAMS_MIN_SIZE) return false;
+  lenia_params merged = fromCore(out);
+  std::memcpy(&merged, in, std::min<size_t>(in->size, sizeof(lenia_params)));
+  CpuLeniaParams params = toCore(merged);
+  if (!validParams(params)) return false;
+  out = params;
+  return true;
+}
+
+template <typename F>
+lenia_status guarded(F&& body) {
+  try {
+    return body();
+  } catch (const std::bad_alloc&) {
+    return LENIA_OUT_OF_MEMORY;
+  } catch (...) {
+    return LENIA_INTERNAL_ERROR;
+  }
+}
+
+}  // namespace
+
+struct lenia_sim {
+  CpuLeniaParams params;
+  std::vector<float> particles;
+  std::vector<float> next;
+  std::vector<int> ids;
+  int64_t steps = 0;
+
+  void resize(int count) {
+    particles.resize(static_cast<size_t>(count) * STRIDE, 0.0f);
+    ids.resize(count);
+    std::iota(ids.begin(), ids.end(), 0);
+  }
+
+  void step() {
+    int count = static_cast<int>(ids.size());
+    CpuLenia(params).step(particles, ids, count, next);
+    particles.swap(next);
+    steps++;
+  }
+};
+
+extern "C" {
+
+uint32_t lenia_api_version(void) { return LENIA_API_VERSION; }
+
+const char* lenia_status_string(lenia_status status) {
+  switch (status) {
+    case LENIA_OK:
+      return "ok";
+    case LENIA_INVALID_ARGUMENT:
+      return "invalid argument";
+    case LENIA_OUT_OF_MEMORY:
+      return "out of memory";
+    default:
+      return "internal error";
+  }
+}
+
+const char* lenia_outcome_string(lenia_outcome outcome) {
+  return runOutcomeName(static_cast<RunOutcome>(outcome));
+}
+
+lenia_status lenia_default_params(lenia_params* params) {
+  if (!params || params->size < PARAMS_MIN_SIZE) return LENIA_INVALID_ARGUMENT;
+  lenia_params defaults = fromCore(CpuLeniaParams());
+  uint32_t size = params->size;
+  std::memcpy(params, &defaults, std::min<size_t>(size, sizeof(lenia_params)));
+  params->size = size;
+  return LENIA_OK;
+}
+
+lenia_sim* lenia_create(const lenia_params* params, int32_t count,
+                        uint32_t seed) {
+  if (count < 0) return nullptr;
+  try {
+    lenia_sim* sim = new lenia_sim();
+    if (params && !readParams(params, sim->params)) {
+      delete sim;
+      return nullptr;
+    }
+    sim->resize(count);
+
+    std::mt19937 rng(seed);
+    for (int i = 0; i < count; i++) {
+      float* p = &sim->particles[static_cast<size_t>(i) * STRIDE];
+      for (int a = 0; a < 3; a++) {
+        std::uniform_real_distribution<float> pos(
+            -sim->params.worldSize[a] / 2.0f, sim->params.worldSize[a] / 2.0f);
+        p[a] = pos(rng);
+      }
+      if (sim->params.planar) p[2] = 0.0f;
+      p[6] = 1.0f;
+    }
+    return sim;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void lenia_destroy(lenia_sim* sim) { delete sim; }
+
+lenia_status lenia_set_params(lenia_sim* sim, const lenia_params* params) {
+  if (!sim) return LENIA_INVALID_ARGUMENT;
+  return readParams(params, sim->params) ? LENIA_OK : LENIA_INVALID_ARGUMENT;
+}
+
+lenia_status lenia_get_params(const lenia_sim* sim, lenia_params* params) {
+  if (!sim || !params || params->size < PARAMS_MIN_SIZE) {
+    return LENIA_INVALID_ARGUMENT;
+  }
+  lenia_params current = fromCore(sim->params);
+  uint32_t size = params->size;
+  std::memcpy(params, &current, std::min<size_t>(size, sizeof(lenia_params)));
+  params->size = size;
+  return LENIA_OK;
+}
+
+lenia_status lenia_set_particle_count(lenia_sim* sim, int32_t count) {
+  if (!sim || count < 0) return LENIA_INVALID_ARGUMENT;
+  return guarded([&] {
+    sim->resize(count);
+    return LENIA_OK;
+  });
+}
+
+lenia_status lenia_particles(lenia_sim* sim, lenia_particle_view* view) {
+  if (!sim || !view || view->size < VIEW_MIN_SIZE) {
+    return LENIA_INVALID_ARGUMENT;
+  }
+  lenia_particle_view full;
+  full.size = view->size;
+  full.data = sim->particles.data();
+  full.count = static_cast<int32_t>(sim->ids.size());
+  full.stride = STRIDE;
+  full.position_offset = 0;
+  full.velocity_offset = 3;
+  full.energy_offset = 6;
+  full.species_offset = 7;
+  full.age_offset = 8;
+  full.dna_offset = 9;
+  full.potential_offset = 14;
+  std::memcpy(view, &full,
+              std::min<size_t>(view->size, sizeof(lenia_particle_view)));
+  return LENIA_OK;
+}
+
+lenia_status lenia_step(lenia_sim* sim, int32_t steps) {
+  if (!sim || steps < 0) return LENIA_INVALID_ARGUMENT;
+  return guarded([&] {
+    for (int s = 0; s < steps; s++) sim->step();
+    return LENIA_OK;
+  });
+}
+
+lenia_status lenia_run(lenia_sim* sim, int32_t max_steps, int32_t check_every,
+                       int32_t* steps_run, lenia_outcome* outcome) {
+  if (!sim || max_steps < 0 || check_every <= 0) return LENIA_INVALID_ARGUMENT;
+  return guarded([&] {
+    SteadyStateOptions options;
+    options.checkEvery = check_every;
+    SteadyStateDetector detector(options);
+    RunOutcome ending = RunOutcome::Running;
+    int s = 0;
+    while (s < max_steps && ending == RunOutcome::Running) {
+      sim->step();
+      s++;
+      if (detector.due(s)) {
+        ending = detector.check(sim->particles.data(),
+                                static_cast<int>(sim->ids.size()), 0);
+      }
+    }
+    if (steps_run) *steps_run = s;
+    if (outcome) *outcome = static_cast<lenia_outcome>(ending);
+    return LENIA_OK;
+  });
+}
+
+int64_t lenia_step_count(const lenia_sim* sim) { return sim ? sim->steps : 0; }
+
+}  // extern "C"
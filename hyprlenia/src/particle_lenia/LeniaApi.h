@@ -0,0 +1,120 @@
+#ifndef CHRONOS_LENIA_API_H
+#define CHRONOS_LENIA_API_H
+
+/* C interface to the headless simulation core (liblenia). Everything is
+ * reached through an opaque lenia_sim handle. Structs passed in carry their
+ * own size, so fields can be added at the end without breaking callers
+ * built against an older header. Functions that can fail return a
+ * lenia_status. */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(LENIA_BUILD)
+#define LENIA_API __declspec(dllexport)
+#else
+#define LENIA_API __declspec(dllimport)
+#endif
+#else
+#define LENIA_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LENIA_API_VERSION 1
+
+typedef struct lenia_sim lenia_sim;
+
+typedef enum lenia_status {
+  LENIA_OK = 0,
+  LENIA_INVALID_ARGUMENT = -1,
+  LENIA_OUT_OF_MEMORY = -2,
+  LENIA_INTERNAL_ERROR = -3
+} lenia_status;
+
+typedef enum lenia_outcome {
+  LENIA_RUNNING = 0,
+  LENIA_EXTINCT = 1,
+  LENIA_SATURATED = 2,
+  LENIA_QUIESCENT = 3,
+  LENIA_PERIODIC = 4
+} lenia_outcome;
+
+typedef struct lenia_params {
+  uint32_t size; /* sizeof(lenia_params) as the caller sees it */
+  float w_k;
+  float mu_k;
+  float sigma_k2;
+  float mu_g;
+  float sigma_g2;
+  float c_rep;
+  float dt;
+  float h;
+  float world_size[3];
+  int32_t planar; /* nonzero ignores z */
+} lenia_params;
+
+/* Particles as stored: `count` records of `stride` floats. The offsets say
+ * where each field starts inside a record. */
+typedef struct lenia_particle_view {
+  uint32_t size; /* sizeof(lenia_particle_view) as the caller sees it */
+  float* data;
+  int32_t count;
+  int32_t stride;
+  int32_t position_offset; /* x, y, z */
+  int32_t velocity_offset; /* x, y, z */
+  int32_t energy_offset;   /* below 0.01 means dead */
+  int32_t species_offset;
+  int32_t age_offset;
+  int32_t dna_offset; /* 5 floats */
+  int32_t potential_offset;
+} lenia_particle_view;
+
+LENIA_API uint32_t lenia_api_version(void);
+LENIA_API const char* lenia_status_string(lenia_status status);
+LENIA_API const char* lenia_outcome_string(lenia_outcome outcome);
+
+/* Fills params with the interactive app's defaults. params->size must be
+ * set first. */
+LENIA_API lenia_status lenia_default_params(lenia_params* params);
+
+/* Creates a simulation with `count` live particles spread uniformly over
+ * the world from `seed`. params may be NULL for the defaults. Returns NULL
+ * on failure. */
+LENIA_API lenia_sim* lenia_create(const lenia_params* params, int32_t count,
+                                  uint32_t seed);
+LENIA_API void lenia_destroy(lenia_sim* sim);
+
+LENIA_API lenia_status lenia_set_params(lenia_sim* sim,
+                                        const lenia_params* params);
+LENIA_API lenia_status lenia_get_params(const lenia_sim* sim,
+                                        lenia_params* params);
+
+/* Grows or shrinks the particle array. New particles are dead until
+ * written through a view. */
+LENIA_API lenia_status lenia_set_particle_count(lenia_sim* sim,
+                                                int32_t count);
+
+/* Points view at the simulation's own particle array, with no copy. Writes
+ * through it change the simulation. The view stays valid until the next
+ * lenia_step, lenia_run, lenia_set_particle_count or lenia_destroy. */
+LENIA_API lenia_status lenia_particles(lenia_sim* sim,
+                                       lenia_particle_view* view);
+
+LENIA_API lenia_status lenia_step(lenia_sim* sim, int32_t steps);
+
+/* Steps until max_steps or until the run settles (see lenia_outcome),
+ * checking every check_every steps. steps_run and outcome may be NULL. */
+LENIA_API lenia_status lenia_run(lenia_sim* sim, int32_t max_steps,
+                                 int32_t check_every, int32_t* steps_run,
+                                 lenia_outcome* outcome);
+
+LENIA_API int64_t lenia_step_count(const lenia_sim* sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  
@@ -0,0 +1,293 @@
+#include "Metrics.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+uint64_t toBits(double v) {
+  uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+double fromBits(uint64_t bits) {
+  double v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+std::string formatValue(double v) {
+  if (std::isnan(v)) return "NaN";
+  if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+  // The shortest form that reads back as the same double.
+  char text[32];
+  for (int digits = 6; digits <= 17; digits++) {
+    std::snprintf(text, sizeof(text), "%.*g", digits, v);
+    if (std::strtod(text, nullptr) == v) break;
+  }
+  return text;
+}
+
+std::string withLabels(const std::string& name, const std::string& labels,
+                        const std::string& extra = "") {
+  std::string all = labels;
+  if (!extra.empty()) all += (all.empty() ? "" : ",") + extra;
+  return all.empty() ? name : name + "{" + all + "}";
+}
+
+}  // namespace
+
+void Metric::add(double v) {
+  bits.store(toBits(get() + v), std::memory_order_relaxed);
+}
+
+void Metric::set(double v) {
+  bits.store(toBits(v), std::memory_order_relaxed);
+}
+
+void Metric::observe(double v) {
+  size_t bucket = 0;
+  while (bucket < bounds.size() && v > bounds[bucket]) bucket++;
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  add(v);
+}
+
+double Metric::get() const {
+  return fromBits(bits.load(std::memory_order_relaxed));
+}
+
+MetricsRegistry::MetricsRegistry() : m_count(0) {}
+
+Metric* MetricsRegistry::counter(const std::string& name,
+                                 const std::string& help,
+                                 const std::string& labels) {
+  return add(MetricKind::Counter, name, help, labels, {});
+}
+
+Metric* MetricsRegistry::gauge(const std::string& name,
+                               const std::string& help,
+                               const std::string& labels) {
+  return add(MetricKind::Gauge, name, help, labels, {});
+}
+
+Metric* MetricsRegistry::histogram(const std::string& name,
+                                   const std::string& help,
+                                   const std::vector<double>& bounds) {
+  return add(MetricKind::Histogram, name, help, "", bounds);
+}
+
+Metric* MetricsRegistry::add(MetricKind kind, const std::string& name,
+                             const std::string& help,
+                             const std::string& labels,
+                             const std::vector<double>& bounds) {
+  int count = m_count.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; i++) {
+    Metric* m = m_slots[i].get();
+    if (m->name == name && m->labels == labels) return m;
+  }
+  if (count == MAX_METRICS) return nullptr;
+
+  auto m = std::make_unique<Metric>();
+  m->kind = kind;
+  m->name = name;
+  m->help = help;
+  m->labels = labels;
+  m->bounds = bounds;
+  if (kind == MetricKind::Histogram) {
+    m->buckets.reset(new std::atomic<uint64_t>[bounds.size() + 1]);
+    for (size_t b = 0; b <= bounds.size(); b++) m->buckets[b] = 0;
+  }
+  m_slots[count] = std::move(m);
+  m_count.store(count + 1, std::memory_order_release);
+  return m_slots[count].get();
+}
+
+std::string MetricsRegistry::render() const {
+  int count = m_count.load(std::memory_order_acquire);
+  std::string out;
+  std::vector<bool> done(count, false);
+
+  // Series sharing a name are one family and must be listed together.
+  for (int first = 0; first < count; first++) {
+    if (done[first]) continue;
+    const Metric& head = *m_slots[first];
+    const char* type = head.kind == MetricKind::Counter ? "counter"
+                       : head.kind == MetricKind::Gauge ? "gauge"
+                                                        : "histogram";
+    out += "# HELP " + head.name + " " + head.help + "\n";
+    out += "# TYPE " + head.name + " " + type + "\n";
+
+    for (int i = first; i < count; i++) {
+      const Metric& m = *m_slots[i];
+      if (done[i] || m.name != head.name) continue;
+      done[i] = true;
+      if (m.kind != MetricKind::Histogram) {
+        out += withLabels(m.name, m.labels) + " " + formatValue(m.get()) +
+               "\n";
+        continue;
+      }
+      uint64_t cumulative = 0;
+      for (size_t b = 0; b <= m.bounds.size(); b++) {
+        cumulative += m.buckets[b].load(std::memory_order_relaxed);
+        std::string le =
+            b < m.bounds.size() ? formatValue(m.bounds[b]) : "+Inf";
+        out += withLabels(m.name + "_bucket", m.labels, "le=\"" + le + "\"") +
+               " " + std::to_string(cumulative) + "\n";
+      }
+      out += withLabels(m.name + "_sum", m.labels) + " " +
+             formatValue(m.get()) + "\n";
+      out += withLabels(m.name + "_count", m.labels) + " " +
+             std::to_string(cumulative) + "\n";
+    }
+  }
+  return out;
+}
+
+MetricsServer::MetricsServer()
+    : m_registry(nullptr),
+      m_listenFd(-1),
+      m_wakeFds{-1, -1},
+      m_stop(false) {}
+
+MetricsServer::~MetricsServer() { stop(); }
+
+#if defined(__unix__)
+
+bool MetricsServer::start(const MetricsRegistry& registry, int port) {
+  stop();
+  m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_listenFd < 0 || pipe2(m_wakeFds, O_NONBLOCK | O_CLOEXEC) != 0) {
+    std::cerr << "Metrics server: " << std::strerror(errno) << std::endl;
+    stop();
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(m_listenFd, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(m_listenFd, 8) != 0) {
+    std::cerr << "Metrics server on port " << port << ": "
+              << std::strerror(errno) << std::endl;
+    stop();
+    return false;
+  }
+
+  m_registry = &registry;
+  m_stop = false;
+  m_thread = std::thread(&MetricsServer::serve, this);
+  std::cout << "Metrics at http://127.0.0.1:" << port << "/metrics"
+            << std::endl;
+  return true;
+}
+
+void MetricsServer::stop() {
+  m_stop = true;
+  if (m_wakeFds[1] >= 0) {
+    char byte = 1;
+    ssize_t ignored = write(m_wakeFds[1], &byte, 1);
+    (void)ignored;
+  }
+  if (m_thread.joinable()) m_thread.join();
+  for (int* fd : {&m_listenFd, &m_wakeFds[0], &m_wakeFds[1]}) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+  }
+}
+
+void MetricsServer::serve() {
+  while (!m_stop) {
+    pollfd fds[2] = {{m_listenFd, POLLIN, 0}, {m_wakeFds[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0 && errno != EINTR) break;
+    if (m_stop) break;
+    if (!(fds[0].revents & POLLIN)) continue;
+    int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) continue;
+    answer(fd);
+    close(fd);
+  }
+}
+
+void MetricsServer::answer(int fd) {
+  // A client that stalls only holds up this thread, and not for long.
+  timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.find("\n\n") == std::string::npos && request.size() < 8192) {
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) break;
+    request.append(buffer, n);
+  }
+
+  std::string status = "200 OK";
+  std::string type = "text/plain; version=0.0.4; charset=utf-8";
+  std::string body;
+  std::string line = request.substr(0, request.find_first_of("\r\n"));
+  bool head = line.rfind("HEAD ", 0) == 0;
+  if (line.rfind("GET ", 0) != 0 && !head) {
+    status = "405 Method Not Allowed";
+    type = "text/plain";
+    body = "only GET is supported\n";
+  } else {
+    std::string path = line.substr(line.find(' ') + 1);
+    path = path.substr(0, path.find(' '));
+    if (path == "/metrics") {
+      body = m_registry->render();
+    } else {
+      status = "404 Not Found";
+      type = "text/plain";
+      body = "try /metrics\n";
+    }
+  }
+
+  std::string response = "HTTP/1.0 " + status + "\r\nContent-Type: " + type +
+                         "\r\nContent-Length: " +
+                         std::to_string(body.size()) +
+                         "\r\nConnection: close\r\n\r\n";
+  if (!head) response += body;
+  size_t sent = 0;
+  while (sent < response.size()) {
+    ssize_t n = send(fd, response.data() + sent, response.size() - sent,
+                     MSG_NOSIGNAL);
+    if (n <= 0) break;
+    sent += n;
+  }
+}
+
+#else
+
+bool MetricsServer::start(const MetricsRegistry& registry, int port) {
+  std::cerr << "The metrics server needs a Unix-like system" << std::endl;
+  return false;
+}
+
+void MetricsServer::stop() {}
+
+void MetricsServer::serve() {}
+
+void MetricsServer::answer(int fd) {}
+
+#endif
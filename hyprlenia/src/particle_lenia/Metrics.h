@@ -0,0 +1,83 @@
+#ifndef CHRONOS_METRICS_H
+#define CHRONOS_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class MetricKind { Counter, Gauge, Histogram };
+
+// One time series. Values are written by a single thread and may be read
+// from any other at the same time.
+struct Metric {
+  MetricKind kind;
+  std::string name;
+  std::string help;
+  std::string labels;          // `pass="step"` style, without braces
+  std::vector<double> bounds;  // histogram bucket upper bounds, ascending
+
+  void add(double v);  // counters
+  void set(double v);  // gauges
+  void observe(double v);
+  double get() const;  // counter or gauge value, or histogram sum
+
+  std::atomic<uint64_t> bits{0};  // the double value (or sum) as bits
+  // Histogram observations per bucket, not cumulative; the last is +Inf.
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+};
+
+// Metrics for the Prometheus text exposition format. Registration and
+// updates happen on one thread; render() may run on another concurrently.
+// The registry only ever appends, publishing each new slot with a release
+// store of the count, so neither side takes a lock.
+class MetricsRegistry {
+ public:
+  static constexpr int MAX_METRICS = 128;
+
+  MetricsRegistry();
+
+  // The existing series if one has the same name and labels. Returns
+  // nullptr once the registry is full.
+  Metric* counter(const std::string& name, const std::string& help,
+                  const std::string& labels = "");
+  Metric* gauge(const std::string& name, const std::string& help,
+                const std::string& labels = "");
+  Metric* histogram(const std::string& name, const std::string& help,
+                    const std::vector<double>& bounds);
+
+  std::string render() const;
+
+ private:
+  Metric* add(MetricKind kind, const std::string& name,
+              const std::string& help, const std::string& labels,
+              const std::vector<double>& bounds);
+
+  std::unique_ptr<Metric> m_slots[MAX_METRICS];
+  std::atomic<int> m_count;
+};
+
+// Serves registry.render() as GET /metrics over HTTP/1.0 on 127.0.0.1 from a
+// background thread, one connection at a time.
+class MetricsServer {
+ public:
+  MetricsServer();
+  ~MetricsServer();
+
+  bool start(const MetricsRegistry& registry, int port);
+  void stop();
+
+ private:
+  void serve();
+  void answer(int fd);
+
+  const MetricsRegistry* m_registry;
+  int m_listenFd;
+  int m_wakeFds[2];
+  std::atomic<bool> m_stop;
+  std::thread m_thread;
+};
+
+#endif  
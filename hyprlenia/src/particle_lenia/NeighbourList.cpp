@@ -0,0 +1,136 @@
+#include "NeighbourList.h"
+
+#include "SpatialHash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr int ENERGY_OFFSET = 6;
+
+float wrapDelta(float d, float size) { return d - size * std::round(d / size); }
+
+// Distinct neighbouring cell coordinates along one periodic axis; fewer than
+// three cells would otherwise visit the same cell twice.
+std::vector<int> neighbourCells(int cell, int cells) {
+  std::vector<int> out;
+  for (int o = -1; o <= 1; o++) {
+    int c = ((cell + o) % cells + cells) % cells;
+    if (std::find(out.begin(), out.end(), c) == out.end()) out.push_back(c);
+  }
+  return out;
+}
+
+}  // namespace
+
+NeighbourList::NeighbourList()
+    : m_count(0),
+      m_stride(0),
+      m_cutoff(0.0f),
+      m_skin(0.0f),
+      m_worldSize{0.0f, 0.0f, 0.0f} {}
+
+void NeighbourList::build(const std::vector<float>& particles, int count,
+                          int stride, float cutoff, float skin, float width,
+                          float height, float depth) {
+  m_count = count;
+  m_stride = stride;
+  m_cutoff = cutoff;
+  m_skin = skin;
+  m_worldSize[0] = width;
+  m_worldSize[1] = height;
+  m_worldSize[2] = depth;
+
+  float radius = cutoff + skin;
+  float radius2 = radius * radius;
+
+  // Cells at least one list radius wide, so only the 27 surrounding cells
+  // can hold neighbours. The hashed grid keeps huge, sparse worlds cheap.
+  m_anchors.assign(count * 4, 0.0f);
+  for (int i = 0; i < count; i++) {
+    const float* p = &particles[i * stride];
+    m_anchors[i * 4 + 0] = p[0];
+    m_anchors[i * 4 + 1] = p[1];
+    m_anchors[i * 4 + 2] = p[2];
+    m_anchors[i * 4 + 3] = p[ENERGY_OFFSET] >= 0.01f ? 1.0f : 0.0f;
+  }
+
+  SpatialHash grid;
+  grid.build(particles, count, stride, radius, width, height, depth);
+  const int* cells = grid.getCells();
+  const std::vector<int>& cellParticles = grid.getParticles();
+
+  // Two identical sweeps: the first sizes each particle's row, the second
+  // fills it at the scanned offset.
+  std::vector<int> counts(count, 0);
+  auto sweep = [&](int i, bool fill) {
+    const float* p = &particles[i * stride];
+    if (p[ENERGY_OFFSET] < 0.01f) return;
+    int cell[3];
+    grid.cellOf(p, cell);
+    int write = fill ? m_offsets[i] : 0;
+    int found = 0;
+
+    for (int z : neighbourCells(cell[2], cells[2])) {
+      for (int y : neighbourCells(cell[1], cells[1])) {
+        for (int x : neighbourCells(cell[0], cells[0])) {
+          int begin, end;
+          grid.cellRange(x, y, z, begin, end);
+          for (int k = begin; k < end; k++) {
+            int j = cellParticles[k];
+            const float* q = &particles[j * stride];
+            float dx = wrapDelta(q[0] - p[0], width);
+            float dy = wrapDelta(q[1] - p[1], height);
+            float dz = wrapDelta(q[2] - p[2], depth);
+            if (dx * dx + dy * dy + dz * dz >= radius2) continue;
+            if (fill) m_indices[write++] = j;
+            found++;
+          }
+        }
+      }
+    }
+    if (!fill) counts[i] = found;
+  };
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < count; i++) sweep(i, false);
+
+  m_offsets.assign(count + 1, 0);
+  for (int i = 0; i < count; i++) m_offsets[i + 1] = m_offsets[i] + counts[i];
+  m_indices.assign(m_offsets[count], 0);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < count; i++) sweep(i, true);
+}
+
+// Largest wrapped distance any particle has moved since the build. A
+// particle born into a slot that was dead at build time is in nobody's
+// list, which counts as an unbounded displacement.
+float NeighbourList::maxDisplacement(const std::vector<float>& particles) const {
+  float maxDisp2 = 0.0f;
+  bool born = false;
+
+#pragma omp parallel for reduction(max : maxDisp2) reduction(|| : born)
+  for (int i = 0; i < m_count; i++) {
+    const float* p = &particles[i * m_stride];
+    if (p[ENERGY_OFFSET] < 0.01f) continue;
+    if (m_anchors[i * 4 + 3] < 0.5f) {
+      born = true;
+      continue;
+    }
+    float dx = wrapDelta(p[0] - m_anchors[i * 4 + 0], m_worldSize[0]);
+    float dy = wrapDelta(p[1] - m_anchors[i * 4 + 1], m_worldSize[1]);
+    float dz = wrapDelta(p[2] - m_anchors[i * 4 + 2], m_worldSize[2]);
+    maxDisp2 = std::max(maxDisp2, dx * dx + dy * dy + dz * dz);
+  }
+
+  if (born) return std::numeric_limits<float>::infinity();
+  return std::sqrt(maxDisp2);
+}
+
+bool NeighbourList::needsRebuild(const std::vector<float>& particles) const {
+  if (m_offsets.empty()) return true;
+  return maxDisplacement(particles) > 0.5f * m_skin;
+}
@@ -0,0 +1,36 @@
+#ifndef CHRONOS_NEIGHBOUR_LIST_H
+#define CHRONOS_NEIGHBOUR_LIST_H
+
+#include <vector>
+
+// CPU Verlet neighbour list over interleaved particle data. Each alive
+// particle stores every alive particle (itself included) within
+// cutoff + skin in CSR form; the list stays valid until some particle has
+// moved more than skin / 2 since the build.
+class NeighbourList {
+ public:
+  NeighbourList();
+
+  void build(const std::vector<float>& particles, int count, int stride,
+             float cutoff, float skin, float width, float height,
+             float depth);
+  float maxDisplacement(const std::vector<float>& particles) const;
+  bool needsRebuild(const std::vector<float>& particles) const;
+
+  const std::vector<int>& getOffsets() const { return m_offsets; }
+  const std::vector<int>& getIndices() const { return m_indices; }
+  int getPairCount() const { return static_cast<int>(m_indices.size()); }
+  float getRadius() const { return m_cutoff + m_skin; }
+
+ private:
+  std::vector<int> m_offsets;
+  std::vector<int> m_indices;
+  std::vector<float> m_anchors;
+  int m_count;
+  int m_stride;
+  float m_cutoff;
+  float m_skin;
+  float m_worldSize[3];
+};
+
+#endif  
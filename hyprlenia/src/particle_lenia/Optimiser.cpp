@@ -0,0 +1,563 @@
+#include "Optimiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+#include "GoalImage.h"
+
+namespace {
+
+constexpr int STRIDE = 15;
+constexpr int GOAL_GRID = 64;
+
+struct Field {
+  const char* name;
+  float CpuLeniaParams::*member;
+  float lo;
+  float hi;
+};
+
+const Field FIELDS[] = {
+    {"w_k", &CpuLeniaParams::w_k, 0.005f, 0.08f},
+    {"mu_k", &CpuLeniaParams::mu_k, 1.0f, 10.0f},
+    {"sigma_k2", &CpuLeniaParams::sigma_k2, 0.2f, 5.0f},
+    {"mu_g", &CpuLeniaParams::mu_g, 0.05f, 1.5f},
+    {"sigma_g2", &CpuLeniaParams::sigma_g2, 0.002f, 0.2f},
+    {"c_rep", &CpuLeniaParams::c_rep, 0.1f, 3.0f},
+    {"dt", &CpuLeniaParams::dt, 0.02f, 0.3f},
+};
+constexpr int FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+const char* fitnessName(OptimiserFitness fitness) {
+  switch (fitness) {
+    case OptimiserFitness::Persistence:
+      return "persistence";
+    case OptimiserFitness::GoalOverlap:
+      return "goal";
+    default:
+      return "displacement";
+  }
+}
+
+float wrapDelta(float d, float size) {
+  if (d > size * 0.5f) return d - size;
+  if (d < -size * 0.5f) return d + size;
+  return d;
+}
+
+// Folds a coordinate back into [0, 1] as if the range edges were mirrors.
+double reflect(double x) {
+  x = std::fmod(std::abs(x), 2.0);
+  return x > 1.0 ? 2.0 - x : x;
+}
+
+// Cyclic Jacobi rotations; the matrices here are a handful of rows.
+void symmetricEigen(std::vector<double> a, int n, std::vector<double>& values,
+                    std::vector<double>& vectors) {
+  vectors.assign(n * n, 0.0);
+  for (int i = 0; i < n; i++) vectors[i * n + i] = 1.0;
+  for (int sweep = 0; sweep < 50; sweep++) {
+    double off = 0.0;
+    for (int p = 0; p < n; p++) {
+      for (int q = p + 1; q < n; q++) off += a[p * n + q] * a[p * n + q];
+    }
+    if (off < 1e-30) break;
+    for (int p = 0; p < n; p++) {
+      for (int q = p + 1; q < n; q++) {
+        double apq = a[p * n + q];
+        if (std::abs(apq) < 1e-300) continue;
+        double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+        double t = (theta >= 0 ? 1.0 : -1.0) /
+                   (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+        double c = 1.0 / std::sqrt(t * t + 1.0);
+        double s = t * c;
+        for (int k = 0; k < n; k++) {
+          double akp = a[k * n + p];
+          double akq = a[k * n + q];
+          a[k * n + p] = c * akp - s * akq;
+          a[k * n + q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < n; k++) {
+          double apk = a[p * n + k];
+          double aqk = a[q * n + k];
+          a[p * n + k] = c * apk - s * aqk;
+          a[q * n + k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < n; k++) {
+          double vkp = vectors[k * n + p];
+          double vkq = vectors[k * n + q];
+          vectors[k * n + p] = c * vkp - s * vkq;
+          vectors[k * n + q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+  values.resize(n);
+  for (int i = 0; i < n; i++) values[i] = a[i * n + i];
+}
+
+int largestCluster(const std::vector<float>& particles, int count,
+                   const float* world, float link) {
+  std::vector<int> parent(count);
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&](int i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  for (int i = 0; i < count; i++) {
+    for (int j = i + 1; j < count; j++) {
+      float dx = wrapDelta(particles[j * STRIDE] - particles[i * STRIDE],
+                           world[0]);
+      float dy = wrapDelta(
+          particles[j * STRIDE + 1] - particles[i * STRIDE + 1], world[1]);
+      if (dx * dx + dy * dy < link * link) parent[find(i)] = find(j);
+    }
+  }
+  std::vector<int> sizes(count, 0);
+  int largest = 0;
+  for (int i = 0; i < count; i++) largest = std::max(largest, ++sizes[find(i)]);
+  return largest;
+}
+
+template <typename T>
+void writeList(std::ostream& out, const char* key, const std::vector<T>& v) {
+  out << key << "=";
+  for (size_t i = 0; i < v.size(); i++) out << (i ? " " : "") << v[i];
+  out << "\n";
+}
+
+template <typename T>
+bool readList(const std::string& value, size_t count, std::vector<T>& v) {
+  std::istringstream in(value);
+  v.assign(count, T());
+  for (size_t i = 0; i < count; i++) {
+    if (!(in >> v[i])) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::vector<std::string> Optimiser::fieldNames() {
+  std::vector<std::string> names;
+  for (const Field& field : FIELDS) names.push_back(field.name);
+  return names;
+}
+
+Optimiser::Optimiser(const OptimiserOptions& options)
+    : m_options(options),
+      m_goalSize(GOAL_GRID),
+      m_sigma(0.3),
+      m_generation(0),
+      m_bestFitness(-1e30f),
+      m_lastMean(0.0f),
+      m_outcomes(5, 0),
+      m_stepFraction(1.0f),
+      m_rng(options.seed) {
+  for (const std::string& name : m_options.fields) {
+    int index = -1;
+    for (int f = 0; f < FIELD_COUNT; f++) {
+      if (name == FIELDS[f].name) index = f;
+    }
+    if (index < 0) {
+      m_error = "unknown field '" + name + "'";
+    } else if (std::find(m_fields.begin(), m_fields.end(), index) ==
+               m_fields.end()) {
+      m_fields.push_back(index);
+    }
+  }
+  if (m_fields.empty() && m_error.empty()) m_error = "no fields to search";
+  if (m_options.fitness == OptimiserFitness::GoalOverlap && m_error.empty() &&
+      !loadGoalImage(m_options.goalPath, m_goalSize, m_goal, m_error)) {
+    m_error = "goal image: " + m_error;
+  }
+  m_options.base.planar = true;
+  m_options.particles = std::max(m_options.particles, 2);
+
+  // Every candidate starts from the same disc in the middle of the world,
+  // so scores differ only by parameters.
+  std::mt19937 initRng(m_options.seed ^ 0x5bd1e995u);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  float discRadius =
+      std::min(m_options.base.worldSize[0], m_options.base.worldSize[1]) * 0.2f;
+  m_initial.assign(static_cast<size_t>(m_options.particles) * STRIDE, 0.0f);
+  for (int i = 0; i < m_options.particles; i++) {
+    float r = discRadius * std::sqrt(unit(initRng));
+    float a = 6.2831853f * unit(initRng);
+    float* p = &m_initial[static_cast<size_t>(i) * STRIDE];
+    p[0] = r * std::cos(a);
+    p[1] = r * std::sin(a);
+    p[6] = 1.0f;
+  }
+
+  m_n = static_cast<int>(m_fields.size());
+  int n = std::max(m_n, 1);
+  m_lambda = m_options.population > 0
+                 ? std::max(m_options.population, 2)
+                 : 4 + static_cast<int>(3.0 * std::log(static_cast<double>(n)));
+  m_mu = m_lambda / 2;
+  m_weights.resize(m_mu);
+  for (int i = 0; i < m_mu; i++) {
+    m_weights[i] = std::log(m_mu + 0.5) - std::log(i + 1.0);
+  }
+  double sum = std::accumulate(m_weights.begin(), m_weights.end(), 0.0);
+  double sumSq = 0.0;
+  for (double& w : m_weights) {
+    w /= sum;
+    sumSq += w * w;
+  }
+  m_muEff = 1.0 / sumSq;
+  m_cSigma = (m_muEff + 2.0) / (n + m_muEff + 5.0);
+  m_dSigma = 1.0 +
+             2.0 * std::max(0.0, std::sqrt((m_muEff - 1.0) / (n + 1.0)) - 1.0) +
+             m_cSigma;
+  m_cc = (4.0 + m_muEff / n) / (n + 4.0 + 2.0 * m_muEff / n);
+  m_c1 = 2.0 / ((n + 1.3) * (n + 1.3) + m_muEff);
+  m_cMu = std::min(1.0 - m_c1, 2.0 * (m_muEff - 2.0 + 1.0 / m_muEff) /
+                                   ((n + 2.0) * (n + 2.0) + m_muEff));
+  m_chiN = std::sqrt(static_cast<double>(n)) *
+           (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+  // Start from the base parameters, scaled into their ranges.
+  m_mean.resize(m_n);
+  for (int i = 0; i < m_n; i++) {
+    const Field& field = FIELDS[m_fields[i]];
+    double value = m_options.base.*field.member;
+    m_mean[i] = std::clamp((value - field.lo) / (field.hi - field.lo), 0.0, 1.0);
+  }
+  m_ps.assign(m_n, 0.0);
+  m_pc.assign(m_n, 0.0);
+  m_C.assign(m_n * m_n, 0.0);
+  for (int i = 0; i < m_n; i++) m_C[i * m_n + i] = 1.0;
+  m_B = m_C;
+  m_D.assign(m_n, 1.0);
+  m_best = m_mean;
+}
+
+bool Optimiser::valid(std::string& error) const {
+  error = m_error;
+  return m_error.empty();
+}
+
+CpuLeniaParams Optimiser::toParams(const std::vector<double>& x) const {
+  CpuLeniaParams params = m_options.base;
+  for (int i = 0; i < m_n; i++) {
+    const Field& field = FIELDS[m_fields[i]];
+    params.*field.member =
+        static_cast<float>(field.lo + x[i] * (field.hi - field.lo));
+  }
+  return params;
+}
+
+float Optimiser::evaluate(const CpuLeniaParams& params, RunOutcome* outcome,
+                          int* stepsRun) const {
+  const int count = m_options.particles;
+  const float* world = params.worldSize;
+  std::vector<int> ids(count);
+  std::iota(ids.begin(), ids.end(), 0);
+  CpuLenia lenia(params);
+
+  std::vector<float> particles = m_initial;
+  std::vector<float> next;
+  // Positions unwrapped across the periodic edges, so the centroid can
+  // travel further than one world.
+  std::vector<double> travelled(static_cast<size_t>(count) * 2, 0.0);
+  auto spread = [&]() {
+    double cx = 0.0, cy = 0.0, s = 0.0;
+    for (int i = 0; i < count; i++) {
+      cx += m_initial[i * STRIDE] + travelled[i * 2];
+      cy += m_initial[i * STRIDE + 1] + travelled[i * 2 + 1];
+    }
+    cx /= count;
+    cy /= count;
+    for (int i = 0; i < count; i++) {
+      double dx = m_initial[i * STRIDE] + travelled[i * 2] - cx;
+      double dy = m_initial[i * STRIDE + 1] + travelled[i * 2 + 1] - cy;
+      s += dx * dx + dy * dy;
+    }
+    return std::sqrt(s / count);
+  };
+  double initialSpread = spread();
+
+  const int samples = 10;
+  int sampleEvery = std::max(1, m_options.steps / samples);
+  double score = 0.0;
+  int scored = 0;
+  auto sampled = [&](int s) {
+    if (s % sampleEvery != 0) return false;
+    return m_options.fitness == OptimiserFitness::Persistence ||
+           (m_options.fitness == OptimiserFitness::GoalOverlap &&
+            s > m_options.steps - 3 * sampleEvery);
+  };
+  auto sampleScore = [&]() {
+    if (m_options.fitness == OptimiserFitness::Persistence) {
+      return static_cast<double>(largestCluster(particles, count, world,
+                                                m_options.clusterLink)) /
+             count;
+    }
+    double overlap = 0.0;
+    for (int i = 0; i < count; i++) {
+      int gx = static_cast<int>(
+          (particles[i * STRIDE] / world[0] + 0.5f) * m_goalSize);
+      int gy = static_cast<int>(
+          (particles[i * STRIDE + 1] / world[1] + 0.5f) * m_goalSize);
+      gx = std::clamp(gx, 0, m_goalSize - 1);
+      gy = std::clamp(gy, 0, m_goalSize - 1);
+      overlap += m_goal[gy * m_goalSize + gx];
+    }
+    return overlap / count;
+  };
+
+  SteadyStateDetector detector(m_options.steadyState);
+  RunOutcome ending = RunOutcome::Running;
+  int s = 1;
+  for (; s <= m_options.steps; s++) {
+    lenia.step(particles, ids, count, next);
+    for (int i = 0; i < count; i++) {
+      for (int a = 0; a < 2; a++) {
+        travelled[i * 2 + a] += wrapDelta(
+            next[i * STRIDE + a] - particles[i * STRIDE + a], world[a]);
+      }
+    }
+    particles.swap(next);
+    if (sampled(s)) {
+      score += sampleScore();
+      scored++;
+    }
+    if (m_options.stopEarly && detector.due(s)) {
+      ending = detector.check(particles.data(), count, 0);
+      if (ending != RunOutcome::Running) break;
+    }
+  }
+  if (stepsRun) *stepsRun = std::min(s, m_options.steps);
+  if (outcome) *outcome = ending;
+
+  // A settled run keeps its current score for the samples it skipped. A
+  // periodic one is only approximately right, so it is treated the same.
+  if (ending != RunOutcome::Running) {
+    double settled = 0.0;
+    bool known = false;
+    for (int rest = s + 1; rest <= m_options.steps; rest++) {
+      if (!sampled(rest)) continue;
+      if (!known) settled = sampleScore();
+      known = true;
+      score += settled;
+      scored++;
+    }
+  }
+
+  for (float v : particles) {
+    if (!std::isfinite(v)) return -1e9f;
+  }
+  if (m_options.fitness != OptimiserFitness::Displacement) {
+    return static_cast<float>(scored > 0 ? score / scored : 0.0);
+  }
+
+  // A blob that flies apart also moves its centroid; only coherent motion
+  // counts in full.
+  double cx = 0.0, cy = 0.0;
+  for (int i = 0; i < count; i++) {
+    cx += travelled[i * 2];
+    cy += travelled[i * 2 + 1];
+  }
+  double displacement = std::sqrt(cx * cx + cy * cy) / count;
+  double growth = spread() / std::max(initialSpread, 1e-6);
+  return static_cast<float>(displacement / (1.0 + std::max(0.0, growth - 2.0)));
+}
+
+void Optimiser::decompose() {
+  // Keep C symmetric against rounding before splitting it.
+  for (int i = 0; i < m_n; i++) {
+    for (int j = i + 1; j < m_n; j++) {
+      double v = 0.5 * (m_C[i * m_n + j] + m_C[j * m_n + i]);
+      m_C[i * m_n + j] = m_C[j * m_n + i] = v;
+    }
+  }
+  std::vector<double> values;
+  symmetricEigen(m_C, m_n, values, m_B);
+  for (int i = 0; i < m_n; i++) m_D[i] = std::sqrt(std::max(values[i], 1e-20));
+}
+
+void Optimiser::runGeneration() {
+  const int n = m_n;
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  // Samples are drawn up front so the random stream does not depend on how
+  // the evaluations are scheduled.
+  std::vector<std::vector<double>> xs(m_lambda, std::vector<double>(n));
+  for (int k = 0; k < m_lambda; k++) {
+    std::vector<double> z(n);
+    for (double& v : z) v = normal(m_rng);
+    for (int i = 0; i < n; i++) {
+      double y = 0.0;
+      for (int j = 0; j < n; j++) y += m_B[i * n + j] * m_D[j] * z[j];
+      xs[k][i] = reflect(m_mean[i] + m_sigma * y);
+    }
+  }
+
+  std::vector<float> fitness(m_lambda);
+  std::vector<RunOutcome> outcomes(m_lambda);
+  std::vector<int> steps(m_lambda);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k = 0; k < m_lambda; k++) {
+    fitness[k] = evaluate(toParams(xs[k]), &outcomes[k], &steps[k]);
+  }
+  m_outcomes.assign(5, 0);
+  for (RunOutcome outcome : outcomes) m_outcomes[static_cast<int>(outcome)]++;
+  m_stepFraction = static_cast<float>(
+      std::accumulate(steps.begin(), steps.end(), 0.0) /
+      (static_cast<double>(m_options.steps) * m_lambda));
+
+  std::vector<int> order(m_lambda);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](int a, int b) { return fitness[a] > fitness[b]; });
+  m_lastMean =
+      std::accumulate(fitness.begin(), fitness.end(), 0.0f) / m_lambda;
+  if (fitness[order[0]] > m_bestFitness) {
+    m_bestFitness = fitness[order[0]];
+    m_best = xs[order[0]];
+  }
+
+  std::vector<double> oldMean = m_mean;
+  for (int i = 0; i < n; i++) {
+    m_mean[i] = 0.0;
+    for (int k = 0; k < m_mu; k++) m_mean[i] += m_weights[k] * xs[order[k]][i];
+  }
+  std::vector<double> yw(n);
+  for (int i = 0; i < n; i++) yw[i] = (m_mean[i] - oldMean[i]) / m_sigma;
+
+  // C^-1/2 yw = B D^-1 B^T yw
+  std::vector<double> bt(n, 0.0), whitened(n, 0.0);
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) bt[j] += m_B[i * n + j] * yw[i];
+    bt[j] /= m_D[j];
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) whitened[i] += m_B[i * n + j] * bt[j];
+  }
+  double psNorm = 0.0;
+  for (int i = 0; i < n; i++) {
+    m_ps[i] = (1.0 - m_cSigma) * m_ps[i] +
+              std::sqrt(m_cSigma * (2.0 - m_cSigma) * m_muEff) * whitened[i];
+    psNorm += m_ps[i] * m_ps[i];
+  }
+  psNorm = std::sqrt(psNorm);
+
+  double decay = 1.0 - std::pow(1.0 - m_cSigma, 2.0 * (m_generation + 1));
+  bool hSigma = psNorm / std::sqrt(decay) < (1.4 + 2.0 / (n + 1.0)) * m_chiN;
+  for (int i = 0; i < n; i++) {
+    m_pc[i] = (1.0 - m_cc) * m_pc[i] +
+              (hSigma ? std::sqrt(m_cc * (2.0 - m_cc) * m_muEff) * yw[i] : 0.0);
+  }
+
+  double keep = 1.0 - m_c1 - m_cMu +
+                (hSigma ? 0.0 : m_c1 * m_cc * (2.0 - m_cc));
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      double rankMu = 0.0;
+      for (int k = 0; k < m_mu; k++) {
+        const std::vector<double>& x = xs[order[k]];
+        rankMu += m_weights[k] * ((x[i] - oldMean[i]) / m_sigma) *
+                  ((x[j] - oldMean[j]) / m_sigma);
+      }
+      m_C[i * n + j] = keep * m_C[i * n + j] + m_c1 * m_pc[i] * m_pc[j] +
+                       m_cMu * rankMu;
+    }
+  }
+
+  m_sigma *= std::exp((m_cSigma / m_dSigma) * (psNorm / m_chiN - 1.0));
+  m_sigma = std::clamp(m_sigma, 1e-8, 1.0);
+  decompose();
+  m_generation++;
+}
+
+bool Optimiser::saveCheckpoint() const {
+  if (m_options.checkpoint.empty()) return true;
+  std::string temp = m_options.checkpoint + ".tmp";
+  {
+    std::ofstream out(temp);
+    if (!out) return false;
+    out.precision(17);
+    out << "fitness=" << fitnessName(m_options.fitness) << "\n";
+    out << "fields=";
+    for (int i = 0; i < m_n; i++) {
+      out << (i ? "," : "") << FIELDS[m_fields[i]].name;
+    }
+    out << "\n";
+    out << "lambda=" << m_lambda << "\n";
+    out << "generation=" << m_generation << "\n";
+    out << "sigma=" << m_sigma << "\n";
+    out << "bestFitness=" << m_bestFitness << "\n";
+    writeList(out, "mean", m_mean);
+    writeList(out, "ps", m_ps);
+    writeList(out, "pc", m_pc);
+    writeList(out, "C", m_C);
+    writeList(out, "best", m_best);
+    out << "rng=" << m_rng << "\n";
+    if (!out) return false;
+  }
+  // Replaced in one step, so an interrupted write never loses the last one.
+  return std::rename(temp.c_str(), m_options.checkpoint.c_str()) == 0;
+}
+
+bool Optimiser::resume() {
+  if (m_options.checkpoint.empty()) return false;
+  std::ifstream in(m_options.checkpoint);
+  if (!in) return false;
+
+  std::string fields;
+  for (int i = 0; i < m_n; i++) {
+    fields += std::string(i ? "," : "") + FIELDS[m_fields[i]].name;
+  }
+
+  Optimiser loaded(*this);
+  std::string line;
+  int matched = 0;
+  while (std::getline(in, line)) {
+    size_t eq = line.find('=');
+    if (eq == std::string::npos) continue;
+    std::string key = line.substr(0, eq);
+    std::string val = line.substr(eq + 1);
+    bool ok = true;
+    if (key == "fitness") {
+      ok = val == fitnessName(m_options.fitness);
+    } else if (key == "fields") {
+      ok = val == fields;
+    } else if (key == "lambda") {
+      ok = std::stoi(val) == m_lambda;
+    } else if (key == "generation") {
+      loaded.m_generation = std::stoi(val);
+    } else if (key == "sigma") {
+      loaded.m_sigma = std::stod(val);
+    } else if (key == "bestFitness") {
+      loaded.m_bestFitness = std::stof(val);
+    } else if (key == "mean") {
+      ok = readList(val, m_n, loaded.m_mean);
+    } else if (key == "ps") {
+      ok = readList(val, m_n, loaded.m_ps);
+    } else if (key == "pc") {
+      ok = readList(val, m_n, loaded.m_pc);
+    } else if (key == "C") {
+      ok = readList(val, m_n * m_n, loaded.m_C);
+    } else if (key == "best") {
+      ok = readList(val, m_n, loaded.m_best);
+    } else if (key == "rng") {
+      std::istringstream state(val);
+      ok = static_cast<bool>(state >> loaded.m_rng);
+    } else {
+      continue;
+    }
+    if (!ok) return false;
+    matched++;
+  }
+  if (matched < 11) return false;
+
+  loaded.decompose();
+  *this = loaded;
+  return true;
+}
@@ -0,0 +1,105 @@
+#ifndef CHRONOS_OPTIMISER_H
+#define CHRONOS_OPTIMISER_H
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CpuLenia.h"
+#include "SteadyState.h"
+
+enum class OptimiserFitness {
+  Displacement,  // how far the centroid travels, penalised for spreading
+  Persistence,   // mean share of particles in the largest cluster
+  GoalOverlap,   // mean goal image value under the particles at the end
+};
+
+struct OptimiserOptions {
+  OptimiserFitness fitness = OptimiserFitness::Displacement;
+  // CpuLeniaParams fields to search; see Optimiser::fieldNames().
+  std::vector<std::string> fields = {"mu_k", "sigma_k2", "mu_g", "sigma_g2"};
+  int population = 0;  // 0 picks the usual 4 + 3 ln(n)
+  int particles = 200;
+  int steps = 300;
+  float clusterLink = 6.0f;  // neighbour distance that joins a cluster
+  std::string goalPath;
+  std::string checkpoint;
+  unsigned seed = 1;
+  // Runs stop as soon as this finds them settled; stopEarly = false always
+  // runs the full budget.
+  bool stopEarly = true;
+  SteadyStateOptions steadyState;
+  CpuLeniaParams base;
+};
+
+// CMA-ES (Hansen's (mu/mu_w, lambda) form with rank-one and rank-mu updates
+// and cumulative step-size control) over a few CpuLeniaParams fields, each
+// scaled to [0, 1] across its range. Every candidate is scored by an
+// independent headless planar CpuLenia run from the same initial disc of
+// particles; a generation's runs are spread over all cores. The search
+// state is written to the checkpoint after every generation and picked up
+// again by resume().
+class Optimiser {
+ public:
+  explicit Optimiser(const OptimiserOptions& options);
+
+  // False, with error set, if a field is unknown or the goal image fails.
+  bool valid(std::string& error) const;
+
+  // Loads the checkpoint if there is one for the same fields and fitness.
+  bool resume();
+  bool saveCheckpoint() const;
+
+  void runGeneration();
+
+  // Scores one parameter set; higher is better. A run that settles early
+  // is scored as if its final state had lasted the rest of the budget.
+  float evaluate(const CpuLeniaParams& params,
+                 RunOutcome* outcome = nullptr, int* stepsRun = nullptr) const;
+
+  int generation() const { return m_generation; }
+  double sigma() const { return m_sigma; }
+  float bestFitness() const { return m_bestFitness; }
+  CpuLeniaParams bestParams() const { return toParams(m_best); }
+  float lastMeanFitness() const { return m_lastMean; }
+  // How the last generation's runs ended, indexed by RunOutcome, and the
+  // share of its step budget they actually used.
+  const std::vector<int>& lastOutcomes() const { return m_outcomes; }
+  float lastStepFraction() const { return m_stepFraction; }
+
+  static std::vector<std::string> fieldNames();
+
+ private:
+  CpuLeniaParams toParams(const std::vector<double>& x) const;
+  void decompose();
+
+  OptimiserOptions m_options;
+  std::vector<int> m_fields;
+  std::string m_error;
+  std::vector<float> m_goal;
+  int m_goalSize;
+  std::vector<float> m_initial;
+
+  int m_n;
+  int m_lambda;
+  int m_mu;
+  std::vector<double> m_weights;
+  double m_muEff, m_cSigma, m_dSigma, m_cc, m_c1, m_cMu, m_chiN;
+
+  std::vector<double> m_mean;
+  double m_sigma;
+  std::vector<double> m_ps;
+  std::vector<double> m_pc;
+  std::vector<double> m_C;  // n x n, row major
+  std::vector<double> m_B;  // eigenvectors of C in columns
+  std::vector<double> m_D;  // square roots of C's eigenvalues
+  int m_generation;
+  std::vector<double> m_best;
+  float m_bestFitness;
+  float m_lastMean;
+  std::vector<int> m_outcomes;
+  float m_stepFraction;
+  std::mt19937 m_rng;
+};
+
+#endif  
@@ -0,0 +1,110 @@
+#include "SpatialHash.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int ENERGY_OFFSET = 6;
+constexpr int64_t EMPTY_KEY = -1;
+constexpr int MAX_CELLS_PER_AXIS = 1 << 20;
+
+uint64_t mixKey(int64_t key) {
+  uint64_t x = static_cast<uint64_t>(key);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return x;
+}
+
+}  // namespace
+
+SpatialHash::SpatialHash()
+    : m_cells{1, 1, 1},
+      m_worldSize{0.0f, 0.0f, 0.0f},
+      m_mask(0),
+      m_occupied(0) {}
+
+int64_t SpatialHash::cellKey(int x, int y, int z) const {
+  return (static_cast<int64_t>(z) * m_cells[1] + y) * m_cells[0] + x;
+}
+
+// Slot holding key, or the empty slot where it would go.
+size_t SpatialHash::findSlot(int64_t key) const {
+  size_t slot = mixKey(key) & m_mask;
+  while (m_keys[slot] != EMPTY_KEY && m_keys[slot] != key) {
+    slot = (slot + 1) & m_mask;
+  }
+  return slot;
+}
+
+void SpatialHash::cellOf(const float* position, int cell[3]) const {
+  for (int a = 0; a < 3; a++) {
+    float u = (position[a] + m_worldSize[a] * 0.5f) / m_worldSize[a];
+    cell[a] = std::clamp(static_cast<int>(u * m_cells[a]), 0, m_cells[a] - 1);
+  }
+}
+
+void SpatialHash::build(const std::vector<float>& particles, int count,
+                        int stride, float cellSize, float width, float height,
+                        float depth) {
+  m_worldSize[0] = width;
+  m_worldSize[1] = height;
+  m_worldSize[2] = depth;
+  for (int a = 0; a < 3; a++) {
+    m_cells[a] = std::clamp(static_cast<int>(m_worldSize[a] / cellSize), 1,
+                            MAX_CELLS_PER_AXIS);
+  }
+
+  // Sort alive particles by cell key; each run of equal keys is one cell.
+  std::vector<int64_t> keyOf(count, EMPTY_KEY);
+#pragma omp parallel for
+  for (int i = 0; i < count; i++) {
+    const float* p = &particles[static_cast<size_t>(i) * stride];
+    if (p[ENERGY_OFFSET] < 0.01f) continue;
+    int c[3];
+    cellOf(p, c);
+    keyOf[i] = cellKey(c[0], c[1], c[2]);
+  }
+
+  m_particles.clear();
+  for (int i = 0; i < count; i++) {
+    if (keyOf[i] != EMPTY_KEY) m_particles.push_back(i);
+  }
+  std::stable_sort(m_particles.begin(), m_particles.end(),
+                   [&](int a, int b) { return keyOf[a] < keyOf[b]; });
+
+  m_occupied = 0;
+  for (size_t k = 0; k < m_particles.size(); k++) {
+    if (k == 0 || keyOf[m_particles[k]] != keyOf[m_particles[k - 1]]) {
+      m_occupied++;
+    }
+  }
+
+  // At most half full, so probe sequences stay short.
+  size_t slots = 16;
+  while (slots < static_cast<size_t>(m_occupied) * 2) slots *= 2;
+  m_mask = slots - 1;
+  m_keys.assign(slots, EMPTY_KEY);
+  m_begin.assign(slots, 0);
+  m_end.assign(slots, 0);
+
+  for (size_t k = 0; k < m_particles.size();) {
+    int64_t key = keyOf[m_particles[k]];
+    size_t end = k + 1;
+    while (end < m_particles.size() && keyOf[m_particles[end]] == key) end++;
+    size_t slot = findSlot(key);
+    m_keys[slot] = key;
+    m_begin[slot] = static_cast<int>(k);
+    m_end[slot] = static_cast<int>(end);
+    k = end;
+  }
+}
+
+void SpatialHash::cellRange(int x, int y, int z, int& begin, int& end) const {
+  begin = end = 0;
+  if (m_keys.empty()) return;
+  size_t slot = findSlot(cellKey(x, y, z));
+  if (m_keys[slot] == EMPTY_KEY) return;
+  begin = m_begin[slot];
+  end = m_end[slot];
+}
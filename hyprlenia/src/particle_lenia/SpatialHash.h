@@ -0,0 +1,43 @@
+#ifndef CHRONOS_SPATIAL_HASH_H
+#define CHRONOS_SPATIAL_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Periodic uniform grid whose occupied cells live in an open-addressing hash
+// table, so memory follows the particle count rather than the world volume.
+// CPU counterpart of the hashed grid built by grid_cells.comp.
+class SpatialHash {
+ public:
+  SpatialHash();
+
+  // Bins every alive particle (energy >= 0.01) into cells at least cellSize
+  // wide.
+  void build(const std::vector<float>& particles, int count, int stride,
+             float cellSize, float width, float height, float depth);
+
+  // Particles of cell (x, y, z) are getParticles()[begin, end); empty and
+  // unknown cells give an empty range.
+  void cellRange(int x, int y, int z, int& begin, int& end) const;
+  void cellOf(const float* position, int cell[3]) const;
+
+  const std::vector<int>& getParticles() const { return m_particles; }
+  const int* getCells() const { return m_cells; }
+  int getOccupiedCells() const { return m_occupied; }
+
+ private:
+  int64_t cellKey(int x, int y, int z) const;
+  size_t findSlot(int64_t key) const;
+
+  int m_cells[3];
+  float m_worldSize[3];
+  std::vector<int64_t> m_keys;
+  std::vector<int> m_begin;
+  std::vector<int> m_end;
+  std::vector<int> m_particles;
+  size_t m_mask;
+  int m_occupied;
+};
+
+#endif  
@@ -0,0 +1,96 @@
+#include "SteadyState.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int STRIDE = 15;
+
+// splitmix64 finaliser.
+uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+const char* runOutcomeName(RunOutcome outcome) {
+  switch (outcome) {
+    case RunOutcome::Extinct:
+      return "extinct";
+    case RunOutcome::Saturated:
+      return "saturated";
+    case RunOutcome::Quiescent:
+      return "quiescent";
+    case RunOutcome::Periodic:
+      return "periodic";
+    default:
+      return "running";
+  }
+}
+
+SteadyStateDetector::SteadyStateDetector(const SteadyStateOptions& options)
+    : m_options(options) {
+  m_options.checkEvery = std::max(m_options.checkEvery, 1);
+  reset();
+}
+
+void SteadyStateDetector::reset() {
+  m_history.clear();
+  m_quietChecks = 0;
+  m_fullChecks = 0;
+  m_period = 0;
+  m_meanSpeed = 0.0f;
+  m_outcome = RunOutcome::Running;
+}
+
+RunOutcome SteadyStateDetector::check(const float* particles, int count,
+                                      int capacity) {
+  int alive = 0;
+  double speed = 0.0;
+  uint64_t hash = 0;
+  float inverseQuantum = 1.0f / m_options.positionQuantum;
+  for (int i = 0; i < count; i++) {
+    const float* p = particles + static_cast<size_t>(i) * STRIDE;
+    if (p[6] < 0.01f) continue;
+    alive++;
+    speed += std::sqrt(p[3] * p[3] + p[4] * p[4] + p[5] * p[5]);
+    uint64_t h = 0;
+    for (int a = 0; a < 3; a++) {
+      int64_t q = static_cast<int64_t>(std::floor(p[a] * inverseQuantum));
+      h = mix(h ^ static_cast<uint64_t>(q));
+    }
+    hash += mix(h);
+  }
+  m_meanSpeed = alive > 0 ? static_cast<float>(speed / alive) : 0.0f;
+
+  bool quiet = m_meanSpeed < m_options.quiescentSpeed;
+  m_quietChecks = quiet ? m_quietChecks + 1 : 0;
+  m_fullChecks = capacity > 0 && alive >= capacity ? m_fullChecks + 1 : 0;
+
+  auto seen = std::find(m_history.rbegin(), m_history.rend(), hash);
+  if (alive == 0) {
+    m_outcome = RunOutcome::Extinct;
+  } else if (m_fullChecks >= m_options.settleChecks) {
+    m_outcome = RunOutcome::Saturated;
+  } else if (m_quietChecks >= m_options.settleChecks) {
+    m_outcome = RunOutcome::Quiescent;
+  } else if (seen != m_history.rend()) {
+    // A frozen state repeats every check too, but is reported as quiescent
+    // once it has been still for long enough.
+    m_period = static_cast<int>(seen - m_history.rbegin() + 1) *
+               m_options.checkEvery;
+    m_outcome = quiet ? RunOutcome::Running : RunOutcome::Periodic;
+  } else {
+    m_outcome = RunOutcome::Running;
+  }
+
+  m_history.push_back(hash);
+  if (static_cast<int>(m_history.size()) > m_options.periodHistory) {
+    m_history.erase(m_history.begin());
+  }
+  return m_outcome;
+}
@@ -0,0 +1,58 @@
+#ifndef CHRONOS_STEADY_STATE_H
+#define CHRONOS_STEADY_STATE_H
+
+#include <cstdint>
+#include <vector>
+
+enum class RunOutcome {
+  Running,
+  Extinct,     // no particle alive
+  Saturated,   // every slot alive, so births can no longer happen
+  Quiescent,   // mean speed has stayed below quiescentSpeed
+  Periodic,    // the quantised state has been seen before
+};
+
+const char* runOutcomeName(RunOutcome outcome);
+
+struct SteadyStateOptions {
+  int checkEvery = 20;
+  float quiescentSpeed = 1e-4f;
+  int settleChecks = 3;  // checks in a row before quiescence or saturation
+  float positionQuantum = 1e-3f;
+  int periodHistory = 64;  // checks remembered for periodicity
+};
+
+// Decides from a particle array (stride 15) every checkEvery steps whether
+// a run has reached a state it will not leave, so batch runs can stop
+// early. The periodicity hash is a sum of per-particle hashes, so it does
+// not depend on particle order, and only finds periods that are multiples
+// of checkEvery.
+class SteadyStateDetector {
+ public:
+  explicit SteadyStateDetector(
+      const SteadyStateOptions& options = SteadyStateOptions());
+
+  void reset();
+  bool due(int64_t step) const {
+    return step > 0 && step % m_options.checkEvery == 0;
+  }
+
+  // capacity is the number of slots births can use, or 0 if unbounded.
+  RunOutcome check(const float* particles, int count, int capacity);
+
+  RunOutcome outcome() const { return m_outcome; }
+  // Steps between repeats once Periodic.
+  int period() const { return m_period; }
+  float meanSpeed() const { return m_meanSpeed; }
+
+ private:
+  SteadyStateOptions m_options;
+  std::vector<uint64_t> m_history;
+  int m_quietChecks;
+  int m_fullChecks;
+  int m_period;
+  float m_meanSpeed;
+  RunOutcome m_outcome;
+};
+
+#endif  
@@ -14,9 +14,14 @@
 #include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <random>
 #include <vector>
@@ -24,7 +29,19 @@
 
 #include "core/Buffer.h"
 #include "core/ComputeShader.h"
+#include "core/GpuTimer.h"
 #include "core/RenderShader.h"
+#include "core/ShaderPermutations.h"
+#include "particle_lenia/ChunkStore.h"
+#include "particle_lenia/ControlSocket.h"
+#include "particle_lenia/CpuLenia.h"
+#include "particle_lenia/DomainDecomposition.h"
+#include "particle_lenia/GoalImage.h"
+#include "particle_lenia/KernelTuning.h"
+#include "particle_lenia/Metrics.h"
+#include "particle_lenia/NeighbourList.h"
+#include "particle_lenia/Optimiser.h"
+#include "particle_lenia/SteadyState.h"
 
 
 int WINDOW_WIDTH = 1200;
@@ -40,6 +57,9 @@ struct SimulationParams {
   
   int numParticles = 500;
   int maxParticles = 2000;
+  int initPattern = 0;  
+  bool growCapacity = true;
+  bool cacheView = true;
 
   
   float w_k = 0.022f;     
@@ -58,6 +78,31 @@ struct SimulationParams {
   float h = 0.01f;  
 
   
+  bool spatialSort = true;
+  int pairSearch = 0;  
+  bool splitRepulsion = false;
+  int gridStorage = 0;  
+  int stepKernel = 0;  
+  int stepLocalSize = 128;
+  int particlesPerThread = 1;
+  // Off by default: the first tuned step stalls on nine timed variants.
+  bool autoTuneKernel = false;
+  float neighbourSkin = 1.0f;
+  bool sleepEnabled = false;
+  float sleepEpsilon = 0.001f;  
+  int sleepSteps = 120;         
+  float wakeThreshold = 0.005f;
+  bool streamingEnabled = false;
+  float chunkSize = 20.0f;
+  int residentMargin = 1;   
+  int streamInterval = 50;  
+  float activeSpeed = 0.05f;
+  bool rewindEnabled = false;
+  int rewindInterval = 30;
+  int rewindGpuMB = 128;
+  int rewindHostMB = 512;
+
+  
   bool evolutionEnabled = false;
   float birthRate = 0.001f;        
   float deathRate = 0.0f;          
@@ -95,6 +140,7 @@ struct SimulationParams {
   bool showWireframe = false;    
   float ambientLight = 0.5f;     
   float particleSize = 20.0f;    
+  int particleRenderer = 0;  
 
   
   int interactionMode =
@@ -318,6 +364,22 @@ void updateAudioFromParticles(const std::vector<float>& particleData, int maxPar
 
 
 
+// Alive particles binned into a uniform periodic grid: per-cell [start, end)
+// ranges into cell-ordered (position, state) entries. A dense grid keeps a
+// range for every cell; a hashed one keeps only occupied cells in an
+// open-addressing table (hashKeys, hashRanges) sized by the particle count.
+struct CellGrid {
+  Buffer cellStart;
+  Buffer cellEnd;
+  Buffer hashKeys;
+  Buffer hashRanges;
+  Buffer entries;
+  int dims[3] = {1, 1, 1};
+  int cellCapacity = 0;
+  bool hashed = false;
+  int hashSlots = 0;
+};
+
 class ParticleLeniaSimulation {
  public:
   SimulationParams params;
@@ -326,8 +388,130 @@ class ParticleLeniaSimulation {
   Buffer particleBufferB;
   bool useBufferA = true;
 
-  ComputeShader stepShader;
-  RenderShader displayShader;
+  ShaderPermutations<ComputeShader> stepKernels;
+  bool kernel2DActive = false;
+  int stepTileSize = 128;
+  ShaderPermutations<RenderShader> displayPrograms;
+
+  
+  KernelTuningCache kernelTuning{"kernel_tuning.txt"};
+  std::string driverName;
+  std::string tunedWorkload;
+  KernelTuningCache::Choice tunedChoice = {128, 1, 0.0f};
+  std::vector<KernelTuningCache::Choice> tuningTimings;
+  bool retunePending = false;
+  RenderShader splatShader;
+
+  
+  ComputeShader prefixSumShader;
+  ComputeShader splatBinShader;
+  ComputeShader splatRasterShader;
+  Buffer splatTileCounts;
+  Buffer splatTileOffsets;
+  Buffer splatTileEntries;
+  GLuint splatImage = 0;
+  int splatImageWidth = 0;
+  int splatImageHeight = 0;
+  int splatEntryCapacity = 0;
+  // Each frame's entry total is copied from the prefix sum into a slot of a
+  // persistently mapped ring and read once its fence has passed, so the
+  // entries grow a frame or two late instead of stalling every frame.
+  static constexpr int SPLAT_TOTAL_SLOTS = 3;
+  GLuint splatTotalReadback = 0;
+  const uint32_t* splatTotalMapped = nullptr;
+  GLsync splatTotalFences[SPLAT_TOTAL_SLOTS] = {};
+  int splatTotalNext = 0;
+  bool splatEntriesFit = true;
+  bool tiledRasterActive = false;
+
+  
+  ComputeShader mortonKeysShader;
+  ComputeShader radixSortShader;
+  ComputeShader gatherShader;
+  ComputeShader tileBoundsShader;
+  Buffer sortKeysA;
+  Buffer sortKeysB;
+  Buffer sortValuesA;
+  Buffer sortValuesB;
+  Buffer radixCounts;
+  Buffer radixOffsets;
+  Buffer sortAnchors;
+  Buffer tileBounds;
+  bool sortPending = true;
+  int stepsSinceSort = 0;
+  float sortDrift = 0.0f;
+
+  
+  ComputeShader neighbourBuildShader;
+  ComputeShader neighbourDisplacementShader;
+  Buffer neighbourCounts;
+  Buffer neighbourOffsets;
+  Buffer neighbourIndices;
+  Buffer neighbourAnchors;
+  Buffer neighbourMaxDisplacement;
+  // Each displacement maximum, with the step counters' unanchored flag, is
+  // copied into a slot of a persistently mapped ring and read once its fence
+  // has passed, a step or so late, so checking never stalls the pipeline. A
+  // probe remembers how many steps after the build it measured.
+  static constexpr int DISPLACEMENT_SLOTS = 3;
+  struct DisplacementProbe {
+    GLsync fence = nullptr;
+    int steps = 0;
+  };
+  GLuint displacementReadback = 0;
+  const uint32_t* displacementMapped = nullptr;
+  DisplacementProbe displacementProbes[DISPLACEMENT_SLOTS];
+  int displacementNext = 0;
+  // Landed probes since the last build that saw a newborn, i.e. steps the
+  // step kernel spent on the tile fallback.
+  int newbornProbes = 0;
+  int neighbourCapacity = 0;
+  bool neighbourListDirty = true;
+  float neighbourListRadius = 0.0f;
+  float neighbourDisplacement = 0.0f;
+  int neighbourPairs = 0;
+  int stepsSinceNeighbourBuild = 0;
+  int cpuNeighbourPairs = -1;
+  NeighbourList cpuNeighbourList;
+
+  
+  ComputeShader gridKeysShader;
+  ComputeShader gridCellsShader;
+  ComputeShader gridHashShader;
+  CellGrid grid;
+  // Repulsion only reaches distance 1, so with splitRepulsion it is summed
+  // over a grid of unit cells instead of the kernel-wide structure.
+  CellGrid fineGrid;
+
+  
+  // particle_init.comp writes resets straight into both particle buffers.
+  // dartGrid only holds blue-noise darts for the length of a reset.
+  ComputeShader particleInitShader;
+  Buffer dartGrid;
+  Buffer initCounters;
+  float resetMilliseconds = 0.0f;
+
+  ComputeShader sleepWakeShader;
+  Buffer sleepCounters;
+  Buffer stepCounters;
+  int awakeCount = 0;
+  // Particles born and died since the run began, from the step kernel's
+  // counters as of the last updateStats().
+  int64_t births = 0;
+  int64_t deaths = 0;
+  int statsVersion = -1;  // viewVersion at the last updateStats()
+  GpuTimer passTimer;
+
+  // Chunks of the x-y plane away from the view and without moving particles
+  // are paged out to chunkStore and skip simulation until the view or a
+  // drifting cluster comes near them again.
+  ChunkStore chunkStore;
+  int chunkCounts[2] = {1, 1};
+  int stepsSinceStream = 0;
+  int residentChunks = 0;
+  int64_t storedParticles = 0;
+  float lastFocus[2] = {0.0f, 0.0f};
+  float focusDrift[2] = {0.0f, 0.0f};
 
   
   ComputeShader heightmapShader;
@@ -349,6 +533,13 @@ class ParticleLeniaSimulation {
   
   GLuint goalTexture = 0;
   int goalGridSize = 512;
+  ComputeShader goalDistanceShader;
+  GLuint goalSeedTextures[2] = {0, 0};
+  // goalTexture is whichever of these holds a finished field; new goals are
+  // built in the other one and swapped in.
+  GLuint goalTextures[2] = {0, 0};
+  GLuint goalUploadBuffer = 0;
+  GoalImageLoader goalLoader;
 
   std::mt19937 rng;
 
@@ -356,17 +547,81 @@ class ParticleLeniaSimulation {
   int aliveCount = 0;
   float avgEnergy = 0.0f;
   float avgAge = 0.0f;
+  // Checked on every stats update; tells whether the run has died out,
+  // filled up, frozen or fallen into a cycle.
+  SteadyStateDetector steadyState;
   
   
   std::vector<float> historyAlive;
   std::vector<float> historyEnergy;
   const size_t historyMaxSize = 300;
 
+  
+  const float growOccupancy = 0.9f;
+  const float shrinkOccupancy = 0.25f;
+  const int shrinkAfterChecks = 30;
+  const int minCapacity = 1024;
+  int lowOccupancyChecks = 0;
+
+  // Bumped whenever particle, food or goal data changes, so a cached view
+  // knows it has to be redrawn.
+  int viewVersion = 0;
+
+  // Seeds for the step and food shaders' per-step randomness. They are
+  // part of the state a rewind restores, so re-simulating is deterministic.
+  int stepSeed = 0;
+  int foodSeed = 0;
+  int64_t totalSteps = 0;
+
+  // Rewind snapshots (snapshot.comp) taken every rewindInterval steps,
+  // oldest first. The newest live in a ring of GPU slots. When a slot is
+  // reused, its snapshot is copied to a staging buffer and read into host
+  // memory once its fence has passed. Host copies beyond rewindHostMB are
+  // dropped, oldest first.
+  struct RewindSnapshot {
+    int64_t step = 0;
+    int aliveCount = 0;
+    int stepSeed = 0;
+    int foodSeed = 0;
+    int gpuSlot = -1;
+    GLuint staging = 0;
+    GLsync fence = nullptr;
+    std::vector<uint32_t> host;
+  };
+  ComputeShader snapshotShader;
+  GLuint rewindRing = 0;
+  GLuint rewindUpload = 0;
+  size_t rewindSlotBytes = 0;
+  int rewindSlots = 0;
+  size_t rewindHostBytes = 0;
+  std::deque<RewindSnapshot> rewindSnapshots;
+  int rewindCursor = -1;
+  int stepsSinceSnapshot = 0;
+  bool seeded = false;
+  float builtWorld[3] = {0.0f, 0.0f, 0.0f};
+
+  // True when the world size or capacity in params differs from what the
+  // buffers and textures were last built for, so only init() can apply it.
+  bool sizeChanged() const {
+    return builtWorld[0] != params.worldWidth ||
+           builtWorld[1] != params.worldHeight ||
+           builtWorld[2] != params.worldDepth ||
+           particleBufferA.getCount() != params.maxParticles * PARTICLE_FLOATS;
+  }
+
   void init() {
-    
-    rng = std::mt19937(std::random_device{}());
+    // Seeded once per instance, so re-running init() continues the stream.
+    if (!seeded) {
+      rng = std::mt19937(std::random_device{}());
+      seeded = true;
+    }
 
     
+    params.maxParticles = std::max(params.maxParticles, params.numParticles);
+    builtWorld[0] = params.worldWidth;
+    builtWorld[1] = params.worldHeight;
+    builtWorld[2] = params.worldDepth;
+    lowOccupancyChecks = 0;
     int bufferSize = params.maxParticles * PARTICLE_FLOATS;
 
     particleBufferA = Buffer(bufferSize, GL_SHADER_STORAGE_BUFFER);
@@ -375,16 +630,59 @@ class ParticleLeniaSimulation {
     particleBufferA.init();
     particleBufferB.init();
 
+    initSort();
+    initNeighbourList();
+    initSleep();
+    initGrid();
+
+    particleInitShader = ComputeShader("shaders/particle_init.comp");
+    particleInitShader.init();
+    snapshotShader = ComputeShader("shaders/snapshot.comp");
+    snapshotShader.init();
+    dartGrid = Buffer(1, GL_SHADER_STORAGE_BUFFER);
+    initCounters = Buffer(2, GL_SHADER_STORAGE_BUFFER);
+    dartGrid.init();
+    initCounters.init();
+
     
     resetParticles();
 
     
-    stepShader = ComputeShader("shaders/particle_lenia_step.comp");
-    stepShader.init();
-
-    displayShader = RenderShader("shaders/passthrough.vert",
-                                 "shaders/particle_lenia_display.frag");
-    displayShader.init();
+    stepKernels = ShaderPermutations<ComputeShader>(
+        [](const std::vector<std::string>& defines) {
+          return ComputeShader("shaders/particle_lenia_step.comp", defines);
+        });
+    driverName = driverString();
+    kernelTuning.load();
+    tunedWorkload.clear();
+    displayPrograms = ShaderPermutations<RenderShader>(
+        [](const std::vector<std::string>& defines) {
+          return RenderShader("shaders/passthrough.vert",
+                              "shaders/particle_lenia_display.frag", defines);
+        });
+
+    splatShader = RenderShader("shaders/particle_splat.vert",
+                               "shaders/particle_splat.frag");
+    splatShader.init();
+
+    prefixSumShader = ComputeShader("shaders/prefix_sum.comp");
+    prefixSumShader.init();
+    splatBinShader = ComputeShader("shaders/splat_tile_bin.comp");
+    splatBinShader.init();
+    splatRasterShader = ComputeShader("shaders/splat_tile_raster.comp");
+    splatRasterShader.init();
+
+    releaseSplatReadback();
+    glGenBuffers(1, &splatTotalReadback);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, splatTotalReadback);
+    GLbitfield flags =
+        GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, SPLAT_TOTAL_SLOTS * sizeof(uint32_t),
+                    nullptr, flags);
+    splatTotalMapped = static_cast<const uint32_t*>(glMapBufferRange(
+        GL_COPY_WRITE_BUFFER, 0, SPLAT_TOTAL_SLOTS * sizeof(uint32_t), flags));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    splatEntriesFit = true;
 
     
     init3D();
@@ -396,60 +694,811 @@ class ParticleLeniaSimulation {
     initGoal();
   }
 
-  void initGoal() {
-    glGenTextures(1, &goalTexture);
-    glBindTexture(GL_TEXTURE_2D, goalTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, goalGridSize, goalGridSize, 0,
-                 GL_RED, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  void initSort() {
+    int count = params.maxParticles;
+    int sortGroups = (count + 255) / 256;
+    int numTiles = (count + 63) / 64;  // smallest step tile
+
+    sortKeysA = Buffer(count, GL_SHADER_STORAGE_BUFFER);
+    sortKeysB = Buffer(count, GL_SHADER_STORAGE_BUFFER);
+    sortValuesA = Buffer(count, GL_SHADER_STORAGE_BUFFER);
+    sortValuesB = Buffer(count, GL_SHADER_STORAGE_BUFFER);
+    radixCounts = Buffer(16 * sortGroups, GL_SHADER_STORAGE_BUFFER);
+    radixOffsets = Buffer(16 * sortGroups + 1, GL_SHADER_STORAGE_BUFFER);
+    sortAnchors = Buffer(count * 4, GL_SHADER_STORAGE_BUFFER);
+    tileBounds = Buffer(numTiles * 8, GL_SHADER_STORAGE_BUFFER);
+
+    sortKeysA.init();
+    sortKeysB.init();
+    sortValuesA.init();
+    sortValuesB.init();
+    radixCounts.init();
+    radixOffsets.init();
+    sortAnchors.init();
+    tileBounds.init();
+
+    mortonKeysShader = ComputeShader("shaders/morton_keys.comp");
+    mortonKeysShader.init();
+    radixSortShader = ComputeShader("shaders/radix_sort.comp");
+    radixSortShader.init();
+    gatherShader = ComputeShader("shaders/particle_gather.comp");
+    gatherShader.init();
+    tileBoundsShader = ComputeShader("shaders/tile_bounds.comp");
+    tileBoundsShader.init();
+  }
 
-    updateGoalTexture();
+  // Moves every per-particle buffer to a new capacity without a CPU round
+  // trip: surviving slots are copied with glCopyBufferSubData and new slots
+  // start dead. Shrinking sorts first, which puts dead particles last, so
+  // only dead slots are dropped.
+  void setCapacity(int capacity) {
+    if (capacity == params.maxParticles) return;
+    if (capacity < params.maxParticles) sortParticles();
+
+    int sortGroups = (capacity + 255) / 256;
+    particleBufferA.resize(capacity * PARTICLE_FLOATS);
+    particleBufferB.resize(capacity * PARTICLE_FLOATS);
+    sleepCounters.resize(capacity);
+    sortKeysA.resize(capacity);
+    sortKeysB.resize(capacity);
+    sortValuesA.resize(capacity);
+    sortValuesB.resize(capacity);
+    radixCounts.resize(16 * sortGroups);
+    radixOffsets.resize(16 * sortGroups + 1);
+    sortAnchors.resize(capacity * 4);
+    tileBounds.resize((capacity + 63) / 64 * 8);
+    neighbourCounts.resize(capacity);
+    neighbourOffsets.resize(capacity + 1);
+    neighbourAnchors.resize(capacity * 4);
+    grid.entries.resize(capacity * 4);
+    fineGrid.entries.resize(capacity * 4);
+
+    params.maxParticles = capacity;
+    viewVersion++;
+    sortPending = true;
+    neighbourListDirty = true;
+    cpuNeighbourPairs = -1;
   }
 
-  bool loadBMP(const char* filename, std::vector<float>& outData, int size) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-      std::cout << "Failed to open image: " << filename << std::endl;
-      return false;
+  // Doubles capacity once occupancy passes growOccupancy and halves it after
+  // occupancy has stayed under shrinkOccupancy for shrinkAfterChecks stats
+  // updates, never going below minCapacity.
+  void updateCapacity() {
+    if (!params.growCapacity) return;
+    float occupancy = static_cast<float>(aliveCount) / params.maxParticles;
+
+    if (occupancy > growOccupancy) {
+      setCapacity(params.maxParticles * 2);
+      lowOccupancyChecks = 0;
+    } else if (occupancy < shrinkOccupancy &&
+               params.maxParticles > minCapacity) {
+      if (++lowOccupancyChecks >= shrinkAfterChecks) {
+        setCapacity(std::max(minCapacity, params.maxParticles / 2));
+        lowOccupancyChecks = 0;
+      }
+    } else {
+      lowOccupancyChecks = 0;
     }
-    unsigned char header[54];
-    if (!file.read(reinterpret_cast<char*>(header), 54)) return false;
-    if (header[0] != 'B' || header[1] != 'M') return false;
-    int width = *(int*)&header[18];
-    int height = *(int*)&header[22];
-    int imageSize = *(int*)&header[34];
-    if (imageSize == 0) imageSize = width * height * 3;
-    int dataPos = *(int*)&header[10];
-    if (dataPos == 0) dataPos = 54;
-    std::vector<unsigned char> img(imageSize);
-    file.seekg(dataPos);
-    file.read(reinterpret_cast<char*>(img.data()), imageSize);
-    file.close();
-
-    outData.resize(size * size);
+  }
 
-#pragma omp parallel for collapse(2)
-    for (int y = 0; y < size; y++) {
-      for (int x = 0; x < size; x++) {
-        int srcX = x * width / size;
-        int srcY = (size - 1 - y) * height / size;  
-        if (srcX >= width) srcX = width - 1;
-        if (srcY >= height) srcY = height - 1;
-        int idx = (srcY * width + srcX) * 3;
-        if (idx < imageSize - 2) {
-          float val =
-              (img[idx + 2] + img[idx + 1] + img[idx]) / (3.0f * 255.0f);
-          outData[y * size + x] = val;
+  void initNeighbourList() {
+    int count = params.maxParticles;
+    // Sized by the first list build, so other pair searches pay nothing.
+    neighbourCapacity = 1;
+
+    neighbourCounts = Buffer(count, GL_SHADER_STORAGE_BUFFER);
+    neighbourOffsets = Buffer(count + 1, GL_SHADER_STORAGE_BUFFER);
+    neighbourIndices = Buffer(neighbourCapacity, GL_SHADER_STORAGE_BUFFER);
+    neighbourAnchors = Buffer(count * 4, GL_SHADER_STORAGE_BUFFER);
+    neighbourMaxDisplacement = Buffer(1, GL_SHADER_STORAGE_BUFFER);
+
+    neighbourCounts.init();
+    neighbourOffsets.init();
+    neighbourIndices.init();
+    neighbourAnchors.init();
+    neighbourMaxDisplacement.init();
+
+    releaseDisplacementReadback();
+    glGenBuffers(1, &displacementReadback);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, displacementReadback);
+    GLbitfield flags =
+        GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER,
+                    DISPLACEMENT_SLOTS * 2 * sizeof(uint32_t), nullptr, flags);
+    displacementMapped = static_cast<const uint32_t*>(glMapBufferRange(
+        GL_COPY_WRITE_BUFFER, 0, DISPLACEMENT_SLOTS * 2 * sizeof(uint32_t),
+        flags));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    neighbourBuildShader = ComputeShader("shaders/neighbour_list_build.comp");
+    neighbourBuildShader.init();
+    neighbourDisplacementShader =
+        ComputeShader("shaders/neighbour_displacement.comp");
+    neighbourDisplacementShader.init();
+
+    neighbourListDirty = true;
+  }
+
+  // Drops probes still in flight; their maxima are against stale anchors.
+  void discardDisplacementProbes() {
+    for (DisplacementProbe& probe : displacementProbes) {
+      if (probe.fence) glDeleteSync(probe.fence);
+      probe = DisplacementProbe();
+    }
+    newbornProbes = 0;
+  }
+
+  void releaseDisplacementReadback() {
+    discardDisplacementProbes();
+    if (displacementReadback) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, displacementReadback);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      glDeleteBuffers(1, &displacementReadback);
+    }
+    displacementReadback = 0;
+    displacementMapped = nullptr;
+  }
+
+  // Words of stepCounters, matching StepCounters in particle_lenia_step.comp.
+  static constexpr int STEP_AWAKE = 0;
+  static constexpr int STEP_BIRTHS = 1;
+  static constexpr int STEP_DEATHS = 2;
+  static constexpr int STEP_UNANCHORED = 3;
+
+  void clearStepCounter(int word) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stepCounters.getId());
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI,
+                         word * sizeof(GLuint), sizeof(GLuint),
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  void initSleep() {
+    sleepCounters = Buffer(params.maxParticles, GL_SHADER_STORAGE_BUFFER);
+    stepCounters = Buffer(4, GL_SHADER_STORAGE_BUFFER);
+    sleepCounters.init();
+    stepCounters.init();
+    sleepCounters.clear();
+    stepCounters.clear();
+
+    sleepWakeShader = ComputeShader("shaders/sleep_wake.comp");
+    sleepWakeShader.init();
+  }
+
+  // Resets the sleep counters of every particle within radius of a brush.
+  void wakeParticles(float x, float y, float z, float radius) {
+    Buffer& activeBuffer = useBufferA ? particleBufferA : particleBufferB;
+    sleepWakeShader.use();
+    sleepWakeShader.bindBuffer("Particles", activeBuffer, 0);
+    sleepWakeShader.bindBuffer("SleepCounters", sleepCounters, 1);
+    sleepWakeShader.setUniform("u_NumParticles", params.maxParticles);
+    sleepWakeShader.setUniform("u_BrushPos", x, y, z);
+    sleepWakeShader.setUniform("u_BrushRadius", radius);
+    sleepWakeShader.dispatch((params.maxParticles + 255) / 256, 1, 1);
+    sleepWakeShader.wait();
+  }
+
+  // Sleeping skips growth, so it would freeze energy bookkeeping while
+  // evolution runs.
+  bool sleepActive() const {
+    return params.sleepEnabled && !params.evolutionEnabled;
+  }
+
+  float interactionCutoff() const {
+    return params.mu_k + 3.0f * std::sqrt(params.sigma_k2);
+  }
+
+  // Stable LSD radix sort of (sortKeysA, sortValuesA) on the low
+  // 4 * digitPasses key bits. The pass count is rounded up to even so the
+  // result always lands back in the A buffers.
+  void radixSort(int count, int digitPasses) {
+    int sortGroups = (count + 255) / 256;
+    digitPasses = std::min(8, (digitPasses + 1) & ~1);
+
+    for (int pass = 0; pass < digitPasses; pass++) {
+      int shift = pass * 4;
+      bool fromA = pass % 2 == 0;
+      Buffer& keysIn = fromA ? sortKeysA : sortKeysB;
+      Buffer& valuesIn = fromA ? sortValuesA : sortValuesB;
+      Buffer& keysOut = fromA ? sortKeysB : sortKeysA;
+      Buffer& valuesOut = fromA ? sortValuesB : sortValuesA;
+
+      auto bindRadix = [&](bool scatter) {
+        radixSortShader.use();
+        radixSortShader.bindBuffer("KeysIn", keysIn, 0);
+        radixSortShader.bindBuffer("ValuesIn", valuesIn, 1);
+        radixSortShader.bindBuffer("KeysOut", keysOut, 2);
+        radixSortShader.bindBuffer("ValuesOut", valuesOut, 3);
+        radixSortShader.bindBuffer("DigitCounts", radixCounts, 4);
+        radixSortShader.bindBuffer("DigitOffsets", radixOffsets, 5);
+        radixSortShader.setUniform("u_Count", count);
+        radixSortShader.setUniform("u_Shift", shift);
+        radixSortShader.setUniform("u_ScatterPass", scatter);
+      };
+
+      bindRadix(false);
+      radixSortShader.dispatch(sortGroups, 1, 1);
+      radixSortShader.wait();
+
+      prefixSumShader.use();
+      prefixSumShader.bindBuffer("Counts", radixCounts, 0);
+      prefixSumShader.bindBuffer("Offsets", radixOffsets, 1);
+      prefixSumShader.setUniform("u_Count", 16 * sortGroups);
+      prefixSumShader.dispatch(1, 1, 1);
+      prefixSumShader.wait();
+
+      bindRadix(true);
+      radixSortShader.dispatch(sortGroups, 1, 1);
+      radixSortShader.wait();
+    }
+  }
+
+  // Reorders both the particle data and its slot indices along a 30-bit
+  // Morton curve (dead particles sort last) with an 8-pass 4-bit GPU radix
+  // sort, so each 128-particle step tile covers a compact region of space.
+  void sortParticles() {
+    Buffer& src = useBufferA ? particleBufferA : particleBufferB;
+    Buffer& dst = useBufferA ? particleBufferB : particleBufferA;
+    int count = params.maxParticles;
+    int sortGroups = (count + 255) / 256;
+
+    mortonKeysShader.use();
+    mortonKeysShader.bindBuffer("Particles", src, 0);
+    mortonKeysShader.bindBuffer("SortKeys", sortKeysA, 1);
+    mortonKeysShader.bindBuffer("SortValues", sortValuesA, 2);
+    mortonKeysShader.setUniform("u_NumParticles", count);
+    mortonKeysShader.setUniform("u_WorldWidth", params.worldWidth);
+    mortonKeysShader.setUniform("u_WorldHeight", params.worldHeight);
+    mortonKeysShader.setUniform("u_WorldDepth", params.worldDepth);
+    mortonKeysShader.dispatch(sortGroups, 1, 1);
+    mortonKeysShader.wait();
+
+    radixSort(count, 8);
+
+    gatherShader.use();
+    gatherShader.bindBuffer("ParticlesIn", src, 0);
+    gatherShader.bindBuffer("ParticlesOut", dst, 1);
+    gatherShader.bindBuffer("SortValues", sortValuesA, 2);
+    gatherShader.bindBuffer("SortAnchors", sortAnchors, 3);
+    gatherShader.setUniform("u_NumParticles", count);
+    gatherShader.dispatch(sortGroups, 1, 1);
+    gatherShader.wait();
+
+    useBufferA = !useBufferA;
+    sortPending = false;
+    neighbourListDirty = true;
+    sleepCounters.clear();
+    stepsSinceSort = 0;
+    sortDrift = 0.0f;
+  }
+
+  void computeTileBounds(const Buffer& readBuffer) {
+    tileBoundsShader.use();
+    tileBoundsShader.bindBuffer("Particles", readBuffer, 0);
+    tileBoundsShader.bindBuffer("SortAnchors", sortAnchors, 1);
+    tileBoundsShader.bindBuffer("TileBounds", tileBounds, 2);
+    tileBoundsShader.setUniform("u_NumParticles", params.maxParticles);
+    tileBoundsShader.setUniform("u_TileSize", stepTileSize);
+    tileBoundsShader.setUniform("u_WorldWidth", params.worldWidth);
+    tileBoundsShader.setUniform("u_WorldHeight", params.worldHeight);
+    tileBoundsShader.setUniform("u_WorldDepth", params.worldDepth);
+    tileBoundsShader.dispatch(stepTileCount(), 1, 1);
+    tileBoundsShader.wait();
+  }
+
+  // Tiles grow as particles drift away from where the last sort put them;
+  // once the mean per-tile drift reaches a quarter of the kernel cutoff the
+  // AABB test stops culling much, so schedule another sort. Fast-moving
+  // scenes re-sort often, settled ones almost never.
+  void updateSortDrift() {
+    int numTiles = stepTileCount();
+    std::vector<float> bounds = tileBounds.getData(0, numTiles * 8);
+    float totalDrift = 0.0f;
+    int occupied = 0;
+    for (int t = 0; t < numTiles; t++) {
+      if (bounds[t * 8 + 7] < 0.5f) continue;
+      totalDrift += bounds[t * 8 + 3];
+      occupied++;
+    }
+    sortDrift = occupied > 0 ? totalDrift / occupied : 0.0f;
+    if (sortDrift > 0.25f * interactionCutoff()) sortPending = true;
+  }
+
+  // Radius the step kernel needs (cutoff plus the finite-difference offset)
+  // widened by the Verlet skin.
+  float neighbourListRadiusFor() const {
+    return interactionCutoff() + params.h + params.neighbourSkin;
+  }
+
+  // Builds the CSR neighbour list of every alive particle: a count pass, a
+  // prefix sum into row offsets, then a fill pass. The index buffer grows
+  // when the pair count outruns it.
+  void buildNeighbourList(const Buffer& readBuffer) {
+    int count = params.maxParticles;
+    int groups = (count + 127) / 128;
+    neighbourListRadius = neighbourListRadiusFor();
+
+    auto bindBuild = [&](bool fill) {
+      neighbourBuildShader.use();
+      neighbourBuildShader.bindBuffer("Particles", readBuffer, 0);
+      neighbourBuildShader.bindBuffer("NeighbourCounts", neighbourCounts, 1);
+      neighbourBuildShader.bindBuffer("NeighbourOffsets", neighbourOffsets, 2);
+      neighbourBuildShader.bindBuffer("NeighbourIndices", neighbourIndices, 3);
+      neighbourBuildShader.bindBuffer("NeighbourAnchors", neighbourAnchors, 4);
+      neighbourBuildShader.setUniform("u_NumParticles", count);
+      neighbourBuildShader.setUniform("u_FillPass", fill);
+      neighbourBuildShader.setUniform("u_ListRadius", neighbourListRadius);
+      glUniform1ui(neighbourBuildShader.getUniformLocation("u_IndexCapacity"),
+                   static_cast<GLuint>(neighbourCapacity));
+      neighbourBuildShader.setUniform("u_WorldWidth", params.worldWidth);
+      neighbourBuildShader.setUniform("u_WorldHeight", params.worldHeight);
+      neighbourBuildShader.setUniform("u_WorldDepth", params.worldDepth);
+      neighbourBuildShader.setUniform("u_Planar", kernel2DActive);
+    };
+
+    bindBuild(false);
+    neighbourBuildShader.dispatch(groups, 1, 1);
+    neighbourBuildShader.wait();
+
+    prefixSumShader.use();
+    prefixSumShader.bindBuffer("Counts", neighbourCounts, 0);
+    prefixSumShader.bindBuffer("Offsets", neighbourOffsets, 1);
+    prefixSumShader.setUniform("u_Count", count);
+    prefixSumShader.dispatch(1, 1, 1);
+    prefixSumShader.wait();
+
+    std::vector<float> total = neighbourOffsets.getData(count, 1);
+    uint32_t pairs = 0;
+    std::memcpy(&pairs, total.data(), sizeof(pairs));
+    neighbourPairs = static_cast<int>(pairs);
+
+    if (neighbourPairs > neighbourCapacity) {
+      neighbourCapacity = neighbourPairs + neighbourPairs / 2;
+      neighbourIndices.cleanup();
+      neighbourIndices = Buffer(neighbourCapacity, GL_SHADER_STORAGE_BUFFER);
+      neighbourIndices.init();
+    }
+
+    bindBuild(true);
+    neighbourBuildShader.dispatch(groups, 1, 1);
+    neighbourBuildShader.wait();
+
+    neighbourListDirty = false;
+    stepsSinceNeighbourBuild = 0;
+    neighbourDisplacement = 0.0f;
+    discardDisplacementProbes();
+    clearStepCounter(STEP_UNANCHORED);
+  }
+
+  // GPU max-reduction of how far any particle has moved since the last
+  // build; past half the skin some pair may have crossed into range unseen.
+  // The decision uses the newest maximum that has landed, scaled up by the
+  // steps taken since it was measured, and a new probe is queued for a
+  // later step. Only a full ring waits, on its oldest probe.
+  // Newborns make the step kernel fall back to the tiles rather than force
+  // a rebuild. A build costs about two tile passes, so once two fallback
+  // steps have been seen the list is rebuilt to take them in.
+  void checkNeighbourDisplacement(const Buffer& readBuffer) {
+    int measured = 0;
+    for (int k = 0; k < DISPLACEMENT_SLOTS; k++) {
+      int slot = (displacementNext + k) % DISPLACEMENT_SLOTS;
+      DisplacementProbe& probe = displacementProbes[slot];
+      if (!probe.fence) continue;
+      bool full = slot == displacementNext;
+      GLenum status = glClientWaitSync(probe.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                       full ? GL_TIMEOUT_IGNORED : 0);
+      // Probes finish in order, so none after this one is ready either.
+      if (status == GL_TIMEOUT_EXPIRED) break;
+      std::memcpy(&neighbourDisplacement, &displacementMapped[slot * 2],
+                  sizeof(float));
+      if (displacementMapped[slot * 2 + 1]) newbornProbes++;
+      Buffer::countRead(2 * sizeof(uint32_t));
+      measured = probe.steps;
+      glDeleteSync(probe.fence);
+      probe = DisplacementProbe();
+    }
+    if (newbornProbes >= 2 ||
+        (measured > 0 && neighbourDisplacement * stepsSinceNeighbourBuild /
+                                 measured >
+                             0.5f * params.neighbourSkin)) {
+      neighbourListDirty = true;
+      return;
+    }
+
+    neighbourMaxDisplacement.clear();
+    clearStepCounter(STEP_UNANCHORED);
+
+    neighbourDisplacementShader.use();
+    neighbourDisplacementShader.bindBuffer("Particles", readBuffer, 0);
+    neighbourDisplacementShader.bindBuffer("NeighbourAnchors", neighbourAnchors,
+                                           1);
+    neighbourDisplacementShader.bindBuffer("MaxDisplacement",
+                                           neighbourMaxDisplacement, 2);
+    neighbourDisplacementShader.bindBuffer("StepCounters", stepCounters, 3);
+    neighbourDisplacementShader.setUniform("u_NumParticles",
+                                           params.maxParticles);
+    neighbourDisplacementShader.setUniform("u_WorldWidth", params.worldWidth);
+    neighbourDisplacementShader.setUniform("u_WorldHeight", params.worldHeight);
+    neighbourDisplacementShader.setUniform("u_WorldDepth", params.worldDepth);
+    neighbourDisplacementShader.dispatch((params.maxParticles + 255) / 256, 1, 1);
+    neighbourDisplacementShader.wait();
+
+    DisplacementProbe& probe = displacementProbes[displacementNext];
+    glBindBuffer(GL_COPY_READ_BUFFER, neighbourMaxDisplacement.getId());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, displacementReadback);
+    GLintptr offset = displacementNext * 2 * sizeof(uint32_t);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset,
+                        sizeof(uint32_t));
+    glBindBuffer(GL_COPY_READ_BUFFER, stepCounters.getId());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        STEP_UNANCHORED * sizeof(uint32_t),
+                        offset + sizeof(uint32_t), sizeof(uint32_t));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    probe.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    probe.steps = stepsSinceNeighbourBuild;
+    displacementNext = (displacementNext + 1) % DISPLACEMENT_SLOTS;
+  }
+
+  // Rebuilds the GPU list and a CPU list from the same particle state and
+  // records the CPU pair count for comparison in the UI.
+  void verifyNeighbourList() {
+    Buffer& readBuffer = useBufferA ? particleBufferA : particleBufferB;
+    buildNeighbourList(readBuffer);
+    cpuNeighbourList.build(readBuffer.getData(), params.maxParticles,
+                           PARTICLE_FLOATS, interactionCutoff() + params.h,
+                           params.neighbourSkin, params.worldWidth,
+                           params.worldHeight, params.worldDepth);
+    cpuNeighbourPairs = cpuNeighbourList.getPairCount();
+  }
+
+  void initGrid() {
+    for (CellGrid* g : {&grid, &fineGrid}) {
+      g->entries = Buffer(params.maxParticles * 4, GL_SHADER_STORAGE_BUFFER);
+      g->entries.init();
+      g->cellCapacity = 0;
+    }
+
+    gridKeysShader = ComputeShader("shaders/grid_keys.comp");
+    gridKeysShader.init();
+    gridCellsShader = ComputeShader("shaders/grid_cells.comp");
+    gridCellsShader.init();
+    gridHashShader = ComputeShader("shaders/grid_cells.comp", {"HASHED"});
+    gridHashShader.init();
+  }
+
+  // The step kernel is specialised at compile time: workgroup size and
+  // particles per invocation (a step tile is one workgroup's worth of
+  // particles), the 2D variant, the separate short-range repulsion pass, and
+  // the evolution, food and goal features, which cost nothing when compiled
+  // out.
+  std::vector<std::string> stepKernelDefines(bool planar, int localSize,
+                                             int perThread) const {
+    localSize = std::clamp(localSize, 64, 256);
+    perThread = std::clamp(perThread, 1, 4);
+    std::vector<std::string> defines = {
+        "LOCAL_SIZE " + std::to_string(localSize),
+        "PARTICLES_PER_THREAD " + std::to_string(perThread)};
+    if (planar) defines.push_back("LENIA_2D");
+    if (params.pairSearch == 2 && grid.hashed) {
+      defines.push_back("HASHED_GRID");
+    }
+    if (params.splitRepulsion) {
+      defines.push_back("SHORT_RANGE_GRID");
+      if (fineGrid.hashed) defines.push_back("HASHED_FINE_GRID");
+    }
+    if (params.evolutionEnabled) {
+      defines.push_back("EVOLUTION");
+      if (params.foodEnabled) defines.push_back("FOOD");
+    }
+    if (params.goalMode > 0 && params.goalStrength > 0.001f) {
+      defines.push_back("GOAL");
+    }
+    return defines;
+  }
+
+  std::vector<std::string> displayDefines() const {
+    std::vector<std::string> defines;
+    if (params.showFields && params.fieldType > 0) {
+      defines.push_back("FIELD_TYPE " + std::to_string(params.fieldType));
+    }
+    if (params.showFood) defines.push_back("SHOW_FOOD");
+    if (tiledRasterActive) defines.push_back("PARTICLE_IMAGE");
+    return defines;
+  }
+
+  static std::string driverString() {
+    auto glString = [](GLenum name) {
+      const GLubyte* value = glGetString(name);
+      return value ? std::string(reinterpret_cast<const char*>(value))
+                   : std::string("unknown");
+    };
+    return glString(GL_VENDOR) + " / " + glString(GL_RENDERER) + " / " +
+           glString(GL_VERSION);
+  }
+
+  // What a tuned kernel choice is keyed on besides the driver: kernel
+  // dimensionality, pair search mode and the alive count rounded up to a
+  // power of four, so crossing one of those thresholds picks a new choice.
+  std::string tuningWorkload(bool planar) const {
+    int bucket = 256;
+    while (bucket < aliveCount && bucket < (1 << 24)) bucket *= 4;
+    return std::string(planar ? "2D" : "3D") +
+           " pairs=" + std::to_string(params.pairSearch) +
+           (params.splitRepulsion ? " split" : "") +
+           " n<=" + std::to_string(bucket);
+  }
+
+  // Applies the stored choice for the current workload, measuring one first
+  // when this driver has never seen the workload or a re-tune was asked for.
+  void updateKernelTuning(Buffer& readBuffer, Buffer& writeBuffer,
+                          bool planar) {
+    std::string workload = tuningWorkload(planar);
+    if (workload == tunedWorkload && !retunePending) return;
+
+    KernelTuningCache::Choice choice;
+    if (retunePending || !kernelTuning.find(driverName, workload, choice)) {
+      choice = tuneStepKernel(readBuffer, writeBuffer, planar);
+      kernelTuning.store(driverName, workload, choice);
+    }
+    retunePending = false;
+    tunedWorkload = workload;
+    tunedChoice = choice;
+
+    params.stepLocalSize = choice.localSize;
+    params.particlesPerThread = choice.particlesPerThread;
+    stepTileSize = std::clamp(params.stepLocalSize, 64, 256) *
+                   std::clamp(params.particlesPerThread, 1, 4);
+    if (params.spatialSort) computeTileBounds(readBuffer);
+  }
+
+  // Times every workgroup size / particles-per-thread pair on the current
+  // scene and returns the fastest. Trial outputs land in
+  // the write buffer, which the real step overwrites; the sleep and step
+  // counters and food the trials touch are restored afterwards.
+  KernelTuningCache::Choice tuneStepKernel(Buffer& readBuffer,
+                                           Buffer& writeBuffer, bool planar) {
+    const int localSizes[] = {64, 128, 256};
+    const int perThreadCounts[] = {1, 2, 4};
+    const int timedRuns = 3;
+
+    std::vector<float> savedSleep = sleepCounters.getData();
+    std::vector<float> savedCounters = stepCounters.getData();
+    GLuint savedFood = 0;
+    bool eatsFood = params.evolutionEnabled && params.foodEnabled;
+    if (eatsFood) {
+      glGenTextures(1, &savedFood);
+      glBindTexture(GL_TEXTURE_2D, savedFood);
+      glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, foodGridSize, foodGridSize);
+      glCopyImageSubData(foodTexture, GL_TEXTURE_2D, 0, 0, 0, 0, savedFood,
+                         GL_TEXTURE_2D, 0, 0, 0, 0, foodGridSize, foodGridSize,
+                         1);
+    }
+
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    KernelTuningCache::Choice best = {params.stepLocalSize,
+                                      params.particlesPerThread,
+                                      std::numeric_limits<float>::max()};
+    tuningTimings.clear();
+
+    for (int localSize : localSizes) {
+      for (int perThread : perThreadCounts) {
+        stepTileSize = localSize * perThread;
+        if (params.spatialSort) computeTileBounds(readBuffer);
+
+        ComputeShader& shader =
+            stepKernels.get(stepKernelDefines(planar, localSize, perThread));
+        bindStepKernel(shader, readBuffer, writeBuffer);
+        shader.setUniform("u_RandomSeed", 0);
+
+        // The untimed first dispatch absorbs any deferred driver compile.
+        shader.dispatch(stepTileCount(), 1, 1);
+        shader.wait();
+        glFinish();
+
+        auto start = std::chrono::steady_clock::now();
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        for (int run = 0; run < timedRuns; run++) {
+          shader.dispatch(stepTileCount(), 1, 1);
+          shader.wait();
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        glFinish();
+        std::chrono::duration<float, std::milli> wall =
+            std::chrono::steady_clock::now() - start;
+
+        // Some drivers (llvmpipe among them) report zero for compute work,
+        // in which case the wall clock around glFinish stands in.
+        float total =
+            elapsed > 0 ? static_cast<float>(elapsed) / 1.0e6f : wall.count();
+        float milliseconds = total / timedRuns;
+        tuningTimings.push_back({localSize, perThread, milliseconds});
+        if (milliseconds < best.milliseconds) {
+          best = {localSize, perThread, milliseconds};
         }
       }
     }
-    return true;
+    glDeleteQueries(1, &query);
+
+    sleepCounters.setData(savedSleep);
+    stepCounters.setData(savedCounters);
+    if (eatsFood) {
+      glCopyImageSubData(savedFood, GL_TEXTURE_2D, 0, 0, 0, 0, foodTexture,
+                         GL_TEXTURE_2D, 0, 0, 0, 0, foodGridSize, foodGridSize,
+                         1);
+      glDeleteTextures(1, &savedFood);
+    }
+    return best;
+  }
+
+  int stepTileCount() const {
+    return (params.maxParticles + stepTileSize - 1) / stepTileSize;
+  }
+
+  // The 2D kernel ignores z, which is only sound when the world is much
+  // thinner than the kernel; stepKernel can force either variant.
+  bool use2DKernel() const {
+    if (params.stepKernel == 1) return false;
+    if (params.stepKernel == 2) return true;
+    return params.worldDepth < 0.05f * interactionCutoff();
+  }
+
+  // Cells at least cellSize wide on every axis, flattened to one layer in z
+  // for the 2D kernel. Dense grids cap each axis at 256 cells; hashed grids
+  // allow 1024, since only occupied cells cost memory. gridStorage 0 hashes
+  // once the dense grid would have more cells than the table has slots.
+  void updateGridDims(CellGrid& g, float cellSize, bool planar) {
+    float size[3] = {params.worldWidth, params.worldHeight, params.worldDepth};
+    int slots = 1024;
+    while (slots < 2 * params.maxParticles) slots *= 2;
+
+    int denseCells = 1;
+    for (int a = 0; a < 3; a++) {
+      int cells = static_cast<int>(size[a] / cellSize);
+      if (a == 2 && planar) cells = 1;
+      denseCells *= std::clamp(cells, 1, 256);
+    }
+    bool hashed = params.gridStorage == 2 ||
+                  (params.gridStorage == 0 && denseCells > slots);
+
+    int maxDims = hashed ? 1024 : 256;
+    for (int a = 0; a < 3; a++) {
+      g.dims[a] = std::clamp(static_cast<int>(size[a] / cellSize), 1, maxDims);
+    }
+    if (planar) g.dims[2] = 1;
+
+    if (hashed != g.hashed) {
+      g.cellStart.cleanup();
+      g.cellEnd.cleanup();
+      g.hashKeys.cleanup();
+      g.hashRanges.cleanup();
+      g.cellCapacity = 0;
+      g.hashSlots = 0;
+      g.hashed = hashed;
+    }
+
+    if (hashed) {
+      if (slots != g.hashSlots) {
+        g.hashSlots = slots;
+        g.hashKeys.cleanup();
+        g.hashRanges.cleanup();
+        g.hashKeys = Buffer(slots, GL_SHADER_STORAGE_BUFFER);
+        g.hashRanges = Buffer(slots * 2, GL_SHADER_STORAGE_BUFFER);
+        g.hashKeys.init();
+        g.hashRanges.init();
+      }
+      return;
+    }
+
+    int cells = g.dims[0] * g.dims[1] * g.dims[2];
+    if (cells > g.cellCapacity) {
+      g.cellCapacity = cells;
+      g.cellStart.cleanup();
+      g.cellEnd.cleanup();
+      g.cellStart = Buffer(cells, GL_SHADER_STORAGE_BUFFER);
+      g.cellEnd = Buffer(cells, GL_SHADER_STORAGE_BUFFER);
+      g.cellStart.init();
+      g.cellEnd.init();
+    }
+  }
+
+  // Bins alive particles into a uniform grid: cell keys, a stable radix
+  // sort on just enough digits for the cell count, then per-cell ranges (or
+  // hash table entries) and cell-ordered (position, state) copies. Stable
+  // ordering keeps the step deterministic.
+  void buildGrid(CellGrid& g, float cellSize, const Buffer& readBuffer,
+                 bool planar) {
+    updateGridDims(g, cellSize, planar);
+    int count = params.maxParticles;
+    int groups = (count + 255) / 256;
+    int cells = g.dims[0] * g.dims[1] * g.dims[2];
+
+    gridKeysShader.use();
+    gridKeysShader.bindBuffer("Particles", readBuffer, 0);
+    gridKeysShader.bindBuffer("SortKeys", sortKeysA, 1);
+    gridKeysShader.bindBuffer("SortValues", sortValuesA, 2);
+    gridKeysShader.setUniform("u_NumParticles", count);
+    glUniform3i(gridKeysShader.getUniformLocation("u_GridDims"), g.dims[0],
+                g.dims[1], g.dims[2]);
+    gridKeysShader.setUniform("u_WorldWidth", params.worldWidth);
+    gridKeysShader.setUniform("u_WorldHeight", params.worldHeight);
+    gridKeysShader.setUniform("u_WorldDepth", params.worldDepth);
+    gridKeysShader.dispatch(groups, 1, 1);
+    gridKeysShader.wait();
+
+    int keyBits = 1;
+    while ((1u << keyBits) <= static_cast<unsigned>(cells) && keyBits < 31) {
+      keyBits++;
+    }
+    radixSort(count, (keyBits + 3) / 4);
+
+    ComputeShader& cellsShader = g.hashed ? gridHashShader : gridCellsShader;
+    cellsShader.use();
+    if (g.hashed) {
+      g.hashKeys.clear();
+      cellsShader.bindBuffer("GridHashKeys", g.hashKeys, 3);
+      cellsShader.bindBuffer("GridHashRanges", g.hashRanges, 4);
+      glUniform1ui(cellsShader.getUniformLocation("u_HashMask"),
+                   static_cast<GLuint>(g.hashSlots - 1));
+    } else {
+      g.cellStart.clear();
+      g.cellEnd.clear();
+      cellsShader.bindBuffer("GridCellStart", g.cellStart, 3);
+      cellsShader.bindBuffer("GridCellEnd", g.cellEnd, 4);
+    }
+    cellsShader.bindBuffer("Particles", readBuffer, 0);
+    cellsShader.bindBuffer("SortKeys", sortKeysA, 1);
+    cellsShader.bindBuffer("SortValues", sortValuesA, 2);
+    cellsShader.bindBuffer("GridParticles", g.entries, 5);
+    cellsShader.setUniform("u_NumParticles", count);
+    cellsShader.setUniform("u_Dt", params.dt);
+    cellsShader.dispatch(groups, 1, 1);
+    cellsShader.wait();
+  }
+
+  void initGoal() {
+    releaseGoal();
+    goalDistanceShader = ComputeShader("shaders/goal_distance.comp");
+    goalDistanceShader.init();
+
+    // r: mask, g: signed distance, ba: distance gradient.
+    glGenTextures(2, goalTextures);
+    for (GLuint texture : goalTextures) {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, goalGridSize, goalGridSize, 0,
+                   GL_RGBA, GL_FLOAT, nullptr);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glClearTexImage(texture, 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+    goalTexture = goalTextures[0];
+
+    glGenBuffers(1, &goalUploadBuffer);
+
+    glGenTextures(2, goalSeedTextures);
+    for (GLuint seeds : goalSeedTextures) {
+      glBindTexture(GL_TEXTURE_2D, seeds);
+      glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16I, goalGridSize, goalGridSize);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    updateGoalTexture();
   }
 
+  // Procedural goals are drawn in place; image goals are decoded on the
+  // loader thread and arrive through pollGoalImage, keeping the old goal
+  // active until then.
   void updateGoalTexture() {
+    if (params.goalMode == 4) {
+      goalLoader.request(params.goalImagePath, goalGridSize);
+      return;
+    }
     std::vector<float> data(goalGridSize * goalGridSize, 0.0f);
 
     if (params.goalMode == 1) {  
@@ -503,36 +1552,105 @@ class ParticleLeniaSimulation {
       drawRect(2 * s, 5 * s, 2 * s + thick, thick);
       
       drawRect(6 * s, 3 * s, thick, 4 * s);
-    } else if (params.goalMode == 4) {  
-      if (!loadBMP(params.goalImagePath, data, goalGridSize)) {
+    }
+
+    uploadGoal(data);
+  }
 
+  void pollGoalImage() {
+    std::vector<float> data;
+    bool ok;
+    std::string error;
+    if (!goalLoader.poll(data, ok, error)) return;
+    if (params.goalMode != 4) return;
+
+    if (!ok) {
+      std::cout << "Failed to load goal image " << params.goalImagePath
+                << ": " << error << std::endl;
+      data.assign(goalGridSize * goalGridSize, 0.0f);
 #pragma omp parallel for collapse(2)
-        for (int y = 0; y < goalGridSize; y++) {
-          for (int x = 0; x < goalGridSize; x++) {
-            if (abs(x - y) < 20 || abs(x - (goalGridSize - y)) < 20)
-              data[y * goalGridSize + x] = 1.0f;
-          }
+      for (int y = 0; y < goalGridSize; y++) {
+        for (int x = 0; x < goalGridSize; x++) {
+          if (abs(x - y) < 20 || abs(x - (goalGridSize - y)) < 20)
+            data[y * goalGridSize + x] = 1.0f;
         }
       }
     }
+    uploadGoal(data);
+  }
 
-    glBindTexture(GL_TEXTURE_2D, goalTexture);
+  // Streams the mask through a pixel buffer into the idle goal texture,
+  // builds its distance field there and only then makes it current.
+  void uploadGoal(const std::vector<float>& data) {
+    GLuint target =
+        goalTexture == goalTextures[0] ? goalTextures[1] : goalTextures[0];
+    GLsizeiptr bytes = data.size() * sizeof(float);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, goalUploadBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+      std::memcpy(mapped, data.data(), bytes);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+      glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, bytes, data.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, target);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, goalGridSize, goalGridSize, GL_RED,
-                    GL_FLOAT, data.data());
+                    GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    buildGoalDistanceField(target);
+    goalTexture = target;
+    viewVersion++;
   }
 
-  void saveScene(const std::string& filename) {
-    std::ofstream out(filename);
-    if (!out) {
-        std::cerr << "Failed to save scene: " << filename << std::endl;
-        return;
-    }
-    
+  // Jump flood over the goal mask: seed every texel with itself on its own
+  // side, halve the jump each round, then write the signed distance and its
+  // gradient next to the mask so the step kernel needs a single fetch.
+  void buildGoalDistanceField(GLuint texture) {
+    goalDistanceShader.use();
+    goalDistanceShader.setUniform("u_GridSize", goalGridSize);
+    glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_READ_WRITE,
+                       GL_RGBA16F);
+    int groups = (goalGridSize + 15) / 16;
+
+    int current = 0;
+    auto dispatch = [&](int stage, int step) {
+      glBindImageTexture(1, goalSeedTextures[current], 0, GL_FALSE, 0,
+                         GL_READ_ONLY, GL_RGBA16I);
+      glBindImageTexture(2, goalSeedTextures[1 - current], 0, GL_FALSE, 0,
+                         GL_WRITE_ONLY, GL_RGBA16I);
+      goalDistanceShader.setUniform("u_Stage", stage);
+      goalDistanceShader.setUniform("u_Step", step);
+      glDispatchCompute(groups, groups, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+      if (stage < 2) current = 1 - current;
+    };
+
+    dispatch(0, 0);
+    int step = 1;
+    while (step * 2 < goalGridSize) step *= 2;
+    for (; step >= 1; step /= 2) dispatch(1, step);
+    // An extra unit-step round fixes most of the texels plain JFA gets wrong.
+    dispatch(1, 1);
+    dispatch(2, 0);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+  }
+
+  // Writes every saved parameter as key=value lines, the scene file format.
+  void writeParams(std::ostream& out) const {
     out << "worldWidth=" << params.worldWidth << "\n";
     out << "worldHeight=" << params.worldHeight << "\n";
     out << "worldDepth=" << params.worldDepth << "\n";
     out << "numParticles=" << params.numParticles << "\n";
+    out << "initPattern=" << params.initPattern << "\n";
     out << "maxParticles=" << params.maxParticles << "\n";
+    out << "growCapacity=" << params.growCapacity << "\n";
+    out << "cacheView=" << params.cacheView << "\n";
     out << "w_k=" << params.w_k << "\n";
     out << "mu_k=" << params.mu_k << "\n";
     out << "sigma_k2=" << params.sigma_k2 << "\n";
@@ -541,6 +1659,28 @@ class ParticleLeniaSimulation {
     out << "c_rep=" << params.c_rep << "\n";
     out << "dt=" << params.dt << "\n";
     out << "h=" << params.h << "\n";
+    out << "spatialSort=" << params.spatialSort << "\n";
+    out << "pairSearch=" << params.pairSearch << "\n";
+    out << "splitRepulsion=" << params.splitRepulsion << "\n";
+    out << "gridStorage=" << params.gridStorage << "\n";
+    out << "stepKernel=" << params.stepKernel << "\n";
+    out << "stepLocalSize=" << params.stepLocalSize << "\n";
+    out << "particlesPerThread=" << params.particlesPerThread << "\n";
+    out << "autoTuneKernel=" << params.autoTuneKernel << "\n";
+    out << "neighbourSkin=" << params.neighbourSkin << "\n";
+    out << "sleepEnabled=" << params.sleepEnabled << "\n";
+    out << "sleepEpsilon=" << params.sleepEpsilon << "\n";
+    out << "sleepSteps=" << params.sleepSteps << "\n";
+    out << "wakeThreshold=" << params.wakeThreshold << "\n";
+    out << "streamingEnabled=" << params.streamingEnabled << "\n";
+    out << "chunkSize=" << params.chunkSize << "\n";
+    out << "residentMargin=" << params.residentMargin << "\n";
+    out << "streamInterval=" << params.streamInterval << "\n";
+    out << "activeSpeed=" << params.activeSpeed << "\n";
+    out << "rewindEnabled=" << params.rewindEnabled << "\n";
+    out << "rewindInterval=" << params.rewindInterval << "\n";
+    out << "rewindGpuMB=" << params.rewindGpuMB << "\n";
+    out << "rewindHostMB=" << params.rewindHostMB << "\n";
     out << "evolutionEnabled=" << params.evolutionEnabled << "\n";
     out << "birthRate=" << params.birthRate << "\n";
     out << "deathRate=" << params.deathRate << "\n";
@@ -569,6 +1709,7 @@ class ParticleLeniaSimulation {
     out << "showWireframe=" << params.showWireframe << "\n";
     out << "ambientLight=" << params.ambientLight << "\n";
     out << "particleSize=" << params.particleSize << "\n";
+    out << "particleRenderer=" << params.particleRenderer << "\n";
     out << "interactionMode=" << params.interactionMode << "\n";
     out << "brushRadius=" << params.brushRadius << "\n";
     out << "forceStrength=" << params.forceStrength << "\n";
@@ -576,15 +1717,124 @@ class ParticleLeniaSimulation {
     out << "goalStrength=" << params.goalStrength << "\n";
     out << "showGoal=" << params.showGoal << "\n";
     out << "goalImagePath=" << params.goalImagePath << "\n";
+    out << "sonificationEnabled=" << params.sonificationEnabled << "\n";
+    out << "audioVolume=" << params.audioVolume << "\n";
+    out << "minFrequency=" << params.minFrequency << "\n";
+    out << "maxFrequency=" << params.maxFrequency << "\n";
+    out << "maxVoices=" << params.maxVoices << "\n";
+  }
+
+  // Sets one parameter from its scene file key and text value. False if the
+  // key is unknown or the value does not parse.
+  bool setParam(const std::string& key, const std::string& val) {
+    try {
+      if (key == "worldWidth") params.worldWidth = std::stof(val);
+      else if (key == "worldHeight") params.worldHeight = std::stof(val);
+      else if (key == "worldDepth") params.worldDepth = std::stof(val);
+      else if (key == "numParticles") params.numParticles = std::stoi(val);
+      else if (key == "initPattern") params.initPattern = std::stoi(val);
+      else if (key == "maxParticles") params.maxParticles = std::stoi(val);
+      else if (key == "growCapacity") params.growCapacity = std::stoi(val);
+      else if (key == "cacheView") params.cacheView = std::stoi(val);
+      else if (key == "w_k") params.w_k = std::stof(val);
+      else if (key == "mu_k") params.mu_k = std::stof(val);
+      else if (key == "sigma_k2") params.sigma_k2 = std::stof(val);
+      else if (key == "mu_g") params.mu_g = std::stof(val);
+      else if (key == "sigma_g2") params.sigma_g2 = std::stof(val);
+      else if (key == "c_rep") params.c_rep = std::stof(val);
+      else if (key == "dt") params.dt = std::stof(val);
+      else if (key == "h") params.h = std::stof(val);
+      else if (key == "spatialSort") params.spatialSort = std::stoi(val);
+      else if (key == "pairSearch") params.pairSearch = std::stoi(val);
+      else if (key == "splitRepulsion") params.splitRepulsion = std::stoi(val);
+      else if (key == "gridStorage") params.gridStorage = std::stoi(val);
+      else if (key == "stepKernel") params.stepKernel = std::stoi(val);
+      else if (key == "stepLocalSize") params.stepLocalSize = std::stoi(val);
+      else if (key == "particlesPerThread") params.particlesPerThread = std::stoi(val);
+      else if (key == "autoTuneKernel") params.autoTuneKernel = std::stoi(val);
+      else if (key == "neighbourSkin") params.neighbourSkin = std::stof(val);
+      else if (key == "sleepEnabled") params.sleepEnabled = std::stoi(val);
+      else if (key == "sleepEpsilon") params.sleepEpsilon = std::stof(val);
+      else if (key == "sleepSteps") params.sleepSteps = std::stoi(val);
+      else if (key == "wakeThreshold") params.wakeThreshold = std::stof(val);
+      else if (key == "streamingEnabled") params.streamingEnabled = std::stoi(val);
+      else if (key == "chunkSize") params.chunkSize = std::stof(val);
+      else if (key == "residentMargin") params.residentMargin = std::stoi(val);
+      else if (key == "streamInterval") params.streamInterval = std::stoi(val);
+      else if (key == "activeSpeed") params.activeSpeed = std::stof(val);
+      else if (key == "rewindEnabled") params.rewindEnabled = std::stoi(val);
+      else if (key == "rewindInterval") params.rewindInterval = std::stoi(val);
+      else if (key == "rewindGpuMB") params.rewindGpuMB = std::stoi(val);
+      else if (key == "rewindHostMB") params.rewindHostMB = std::stoi(val);
+      else if (key == "evolutionEnabled") params.evolutionEnabled = std::stoi(val);
+      else if (key == "birthRate") params.birthRate = std::stof(val);
+      else if (key == "deathRate") params.deathRate = std::stof(val);
+      else if (key == "mutationRate") params.mutationRate = std::stof(val);
+      else if (key == "energyDecay") params.energyDecay = std::stof(val);
+      else if (key == "energyFromGrowth") params.energyFromGrowth = std::stof(val);
+      else if (key == "translateX") params.translateX = std::stof(val);
+      else if (key == "translateY") params.translateY = std::stof(val);
+      else if (key == "translateZ") params.translateZ = std::stof(val);
+      else if (key == "zoom") params.zoom = std::stof(val);
+      else if (key == "stepsPerFrame") params.stepsPerFrame = std::stoi(val);
+      else if (key == "showFields") params.showFields = std::stoi(val);
+      else if (key == "fieldType") params.fieldType = std::stoi(val);
+      else if (key == "foodEnabled") params.foodEnabled = std::stoi(val);
+      else if (key == "foodSpawnRate") params.foodSpawnRate = std::stof(val);
+      else if (key == "foodDecayRate") params.foodDecayRate = std::stof(val);
+      else if (key == "foodMaxAmount") params.foodMaxAmount = std::stof(val);
+      else if (key == "foodConsumptionRadius") params.foodConsumptionRadius = std::stof(val);
+      else if (key == "showFood") params.showFood = std::stoi(val);
+      else if (key == "view3D") params.view3D = std::stoi(val);
+      else if (key == "cameraAngle") params.cameraAngle = std::stof(val);
+      else if (key == "cameraRotation") params.cameraRotation = std::stof(val);
+      else if (key == "cameraDistance") params.cameraDistance = std::stof(val);
+      else if (key == "heightScale") params.heightScale = std::stof(val);
+      else if (key == "glowIntensity") params.glowIntensity = std::stof(val);
+      else if (key == "showWireframe") params.showWireframe = std::stoi(val);
+      else if (key == "ambientLight") params.ambientLight = std::stof(val);
+      else if (key == "particleSize") params.particleSize = std::stof(val);
+      else if (key == "particleRenderer") params.particleRenderer = std::stoi(val);
+      else if (key == "interactionMode") params.interactionMode = std::stoi(val);
+      else if (key == "brushRadius") params.brushRadius = std::stof(val);
+      else if (key == "forceStrength") params.forceStrength = std::stof(val);
+      else if (key == "goalMode") params.goalMode = std::stoi(val);
+      else if (key == "goalStrength") params.goalStrength = std::stof(val);
+      else if (key == "showGoal") params.showGoal = std::stoi(val);
+      else if (key == "sonificationEnabled") params.sonificationEnabled = std::stoi(val);
+      else if (key == "audioVolume") params.audioVolume = std::stof(val);
+      else if (key == "minFrequency") params.minFrequency = std::stof(val);
+      else if (key == "maxFrequency") params.maxFrequency = std::stof(val);
+      else if (key == "maxVoices") params.maxVoices = std::stoi(val);
+      else if (key == "goalImagePath") {
+        if (val.length() >= 256) return false;
+        strncpy(params.goalImagePath, val.c_str(), 255);
+      }
+      else return false;
+    } catch (...) {
+      return false;
+    }
+    return true;
+  }
+
+  bool saveScene(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Failed to save scene: " << filename << std::endl;
+        return false;
+    }
+    
+    writeParams(out);
     
     std::cout << "Scene saved to " << filename << std::endl;
+    return true;
   }
 
-  void loadScene(const std::string& filename) {
+  bool loadScene(const std::string& filename) {
     std::ifstream in(filename);
     if (!in) {
         std::cerr << "Failed to load scene: " << filename << std::endl;
-        return;
+        return false;
     }
     
     std::string line;
@@ -593,70 +1843,18 @@ class ParticleLeniaSimulation {
         size_t eqPos = line.find('=');
         if (eqPos == std::string::npos) continue;
         
-        std::string key = line.substr(0, eqPos);
-        std::string val = line.substr(eqPos + 1);
-        
-        try {
-            if (key == "worldWidth") params.worldWidth = std::stof(val);
-            else if (key == "worldHeight") params.worldHeight = std::stof(val);
-            else if (key == "worldDepth") params.worldDepth = std::stof(val);
-            else if (key == "numParticles") params.numParticles = std::stoi(val);
-            else if (key == "maxParticles") params.maxParticles = std::stoi(val);
-            else if (key == "w_k") params.w_k = std::stof(val);
-            else if (key == "mu_k") params.mu_k = std::stof(val);
-            else if (key == "sigma_k2") params.sigma_k2 = std::stof(val);
-            else if (key == "mu_g") params.mu_g = std::stof(val);
-            else if (key == "sigma_g2") params.sigma_g2 = std::stof(val);
-            else if (key == "c_rep") params.c_rep = std::stof(val);
-            else if (key == "dt") params.dt = std::stof(val);
-            else if (key == "h") params.h = std::stof(val);
-            else if (key == "evolutionEnabled") params.evolutionEnabled = std::stoi(val);
-            else if (key == "birthRate") params.birthRate = std::stof(val);
-            else if (key == "deathRate") params.deathRate = std::stof(val);
-            else if (key == "mutationRate") params.mutationRate = std::stof(val);
-            else if (key == "energyDecay") params.energyDecay = std::stof(val);
-            else if (key == "energyFromGrowth") params.energyFromGrowth = std::stof(val);
-            else if (key == "translateX") params.translateX = std::stof(val);
-            else if (key == "translateY") params.translateY = std::stof(val);
-            else if (key == "translateZ") params.translateZ = std::stof(val);
-            else if (key == "zoom") params.zoom = std::stof(val);
-            else if (key == "stepsPerFrame") params.stepsPerFrame = std::stoi(val);
-            else if (key == "showFields") params.showFields = std::stoi(val);
-            else if (key == "fieldType") params.fieldType = std::stoi(val);
-            else if (key == "foodEnabled") params.foodEnabled = std::stoi(val);
-            else if (key == "foodSpawnRate") params.foodSpawnRate = std::stof(val);
-            else if (key == "foodDecayRate") params.foodDecayRate = std::stof(val);
-            else if (key == "foodMaxAmount") params.foodMaxAmount = std::stof(val);
-            else if (key == "foodConsumptionRadius") params.foodConsumptionRadius = std::stof(val);
-            else if (key == "showFood") params.showFood = std::stoi(val);
-            else if (key == "view3D") params.view3D = std::stoi(val);
-            else if (key == "cameraAngle") params.cameraAngle = std::stof(val);
-            else if (key == "cameraRotation") params.cameraRotation = std::stof(val);
-            else if (key == "cameraDistance") params.cameraDistance = std::stof(val);
-            else if (key == "heightScale") params.heightScale = std::stof(val);
-            else if (key == "glowIntensity") params.glowIntensity = std::stof(val);
-            else if (key == "showWireframe") params.showWireframe = std::stoi(val);
-            else if (key == "ambientLight") params.ambientLight = std::stof(val);
-            else if (key == "particleSize") params.particleSize = std::stof(val);
-            else if (key == "interactionMode") params.interactionMode = std::stoi(val);
-            else if (key == "brushRadius") params.brushRadius = std::stof(val);
-            else if (key == "forceStrength") params.forceStrength = std::stof(val);
-            else if (key == "goalMode") params.goalMode = std::stoi(val);
-            else if (key == "goalStrength") params.goalStrength = std::stof(val);
-            else if (key == "showGoal") params.showGoal = std::stoi(val);
-            else if (key == "goalImagePath") {
-                if (val.length() < 256) strncpy(params.goalImagePath, val.c_str(), 255);
-            }
-        } catch (...) {
-        }
+        setParam(line.substr(0, eqPos), line.substr(eqPos + 1));
     }
     std::cout << "Scene loaded from " << filename << std::endl;
     
     init();
+    return true;
   }
 
   void initFood() {
-    
+    if (foodTexture) glDeleteTextures(1, &foodTexture);
+    foodTexture = 0;
+
     foodUpdateShader = ComputeShader("shaders/food_update.comp");
     foodUpdateShader.init();
 
@@ -693,7 +1891,8 @@ class ParticleLeniaSimulation {
   }
 
   void init3D() {
-    
+    release3D();
+
     heightmapShader = ComputeShader("shaders/terrain_heightmap.comp");
     heightmapShader.init();
 
@@ -770,9 +1969,212 @@ class ParticleLeniaSimulation {
     glGenVertexArrays(1, &particleVAO);
   }
 
+  // The init functions above call these first, so running init() again
+  // replaces the GL objects instead of leaking them.
+  void releaseGoal() {
+    glDeleteTextures(2, goalTextures);
+    glDeleteTextures(2, goalSeedTextures);
+    if (goalUploadBuffer) glDeleteBuffers(1, &goalUploadBuffer);
+    goalTextures[0] = goalTextures[1] = 0;
+    goalSeedTextures[0] = goalSeedTextures[1] = 0;
+    goalUploadBuffer = 0;
+    goalTexture = 0;
+  }
+
+  void release3D() {
+    if (heightmapTexture) glDeleteTextures(1, &heightmapTexture);
+    if (terrainVBO) glDeleteBuffers(1, &terrainVBO);
+    if (terrainEBO) glDeleteBuffers(1, &terrainEBO);
+    if (terrainVAO) glDeleteVertexArrays(1, &terrainVAO);
+    if (particleVAO) glDeleteVertexArrays(1, &particleVAO);
+    heightmapTexture = terrainVBO = terrainEBO = terrainVAO = particleVAO = 0;
+  }
+
+  // Continues from a copy of source's particles, food and random state, so
+  // two instances with different params start out identical. Particles
+  // source has paged out are not copied.
+  void copyStateFrom(ParticleLeniaSimulation& source) {
+    resetChunks();
+    resetRewind();
+    setCapacity(source.params.maxParticles);
+
+    const Buffer& from =
+        source.useBufferA ? source.particleBufferA : source.particleBufferB;
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(params.maxParticles) *
+                       PARTICLE_FLOATS * sizeof(float);
+    glBindBuffer(GL_COPY_READ_BUFFER, from.getId());
+    for (Buffer* to : {&particleBufferA, &particleBufferB}) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, to->getId());
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                          bytes);
+    }
+    glCopyImageSubData(source.foodTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                       foodTexture, GL_TEXTURE_2D, 0, 0, 0, 0, foodGridSize,
+                       foodGridSize, 1);
+
+    rng = source.rng;
+    stepSeed = source.stepSeed;
+    foodSeed = source.foodSeed;
+    totalSteps = source.totalSteps;
+    aliveCount = source.aliveCount;
+    sortPending = true;
+    neighbourListDirty = true;
+    sleepCounters.clear();
+    steadyState.reset();
+    viewVersion++;
+  }
+
   void resetParticles() {
-    
-    std::vector<float> data(params.maxParticles * PARTICLE_FLOATS);
+    resetChunks();
+    resetRewind();
+    totalSteps = 0;
+    int resident = params.numParticles;
+    if (params.streamingEnabled) {
+      resident = generateStreamingParticles();
+    } else {
+      if (params.numParticles > params.maxParticles) {
+        setCapacity(params.numParticles);
+      }
+      auto start = std::chrono::steady_clock::now();
+      generateParticles(static_cast<uint32_t>(rng()));
+      glFinish();
+      std::chrono::duration<float, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      resetMilliseconds = elapsed.count();
+    }
+
+    aliveCount = resident;
+    sortPending = true;
+    neighbourListDirty = true;
+    sleepCounters.clear();
+    steadyState.reset();
+    viewVersion++;
+  }
+
+  // Blue noise throws darts into a grid of BLUE_NOISE_CELLS cells per
+  // particle. About half the cells hold a dart once it saturates, so a few
+  // rounds leave more darts than particles to thin down from. Survivors are
+  // picked by a two-level priority histogram (see particle_init.comp).
+  void generateParticles(uint32_t seed) {
+    const int BLUE_NOISE_CELLS = 3;
+    const int BLUE_NOISE_ROUNDS = 6;
+    const int COARSE_BINS = 1 << 12;
+    const int FINE_BINS = 1 << 16;
+    // Priorities are a permutation of 28 bits, so the grid must not exceed
+    // that; the target leaves room for rounding the axes up to even counts.
+    const int MAX_DART_CELLS = 1 << 26;
+    float world[3] = {params.worldWidth, params.worldHeight, params.worldDepth};
+
+    initCounters.resize(4 + COARSE_BINS + FINE_BINS);
+    initCounters.clear();
+    particleInitShader.use();
+    particleInitShader.bindBuffer("ParticlesA", particleBufferA, 0);
+    particleInitShader.bindBuffer("ParticlesB", particleBufferB, 1);
+    particleInitShader.bindBuffer("InitCounters", initCounters, 3);
+    glUniform1ui(particleInitShader.getUniformLocation("u_Seed"), seed);
+    particleInitShader.setUniform("u_Mode", params.initPattern);
+    particleInitShader.setUniform("u_WorldSize", world[0], world[1], world[2]);
+    particleInitShader.setUniform("u_NumParticles", params.numParticles);
+    particleInitShader.setUniform("u_MaxParticles", params.maxParticles);
+    particleInitShader.setUniform("u_StampSize", 40);
+    particleInitShader.setUniform("u_StampRadius", 3.0f);
+
+    int dims[3] = {1, 1, 1};
+    if (params.initPattern == 1 && params.numParticles > 0) {
+      int cellTarget = std::min(
+          MAX_DART_CELLS, params.numParticles * BLUE_NOISE_CELLS);
+      // Cells are sized over the axes thicker than one cell, so a thin
+      // slab is solved in 2D (or a needle in 1D) rather than packing all
+      // its cells into a fraction of their volume.
+      bool thin[3] = {false, false, false};
+      int axes = 3;
+      float cellSize = 0.0f;
+      while (true) {
+        float volume = 1.0f;
+        for (int a = 0; a < 3; a++) {
+          if (!thin[a]) volume *= world[a];
+        }
+        cellSize = std::pow(volume / cellTarget, 1.0f / axes);
+        int thinnest = -1;
+        for (int a = 0; a < 3; a++) {
+          if (thin[a] || world[a] >= cellSize) continue;
+          if (thinnest < 0 || world[a] < world[thinnest]) thinnest = a;
+        }
+        if (thinnest < 0 || axes == 1) break;
+        thin[thinnest] = true;
+        axes--;
+      }
+      float radius = 0.0f;
+      int cells = 1;
+      for (int a = 0; a < 3; a++) {
+        // Cells of a phase sit two apart, so axes are rounded to an even
+        // count to keep that true across the periodic seam. Axes of one or
+        // two cells are searched whole and do not limit the radius.
+        int n = std::max(1, static_cast<int>(std::round(world[a] / cellSize)));
+        if (n > 1) n = (n + 1) / 2 * 2;
+        dims[a] = n;
+        cells *= n;
+        if (n > 2) {
+          radius = radius > 0.0f ? std::min(radius, world[a] / n)
+                                 : world[a] / n;
+        }
+      }
+      if (radius == 0.0f) radius = cellSize;
+
+      dartGrid.resize(cells);
+      dartGrid.clear();
+      particleInitShader.bindBuffer("DartGrid", dartGrid, 2);
+      glUniform3i(particleInitShader.getUniformLocation("u_GridDims"), dims[0],
+                  dims[1], dims[2]);
+      particleInitShader.setUniform("u_Radius", radius);
+
+      int stride[3];
+      for (int a = 0; a < 3; a++) stride[a] = std::min(dims[a], 2);
+      glUniform3i(particleInitShader.getUniformLocation("u_PhaseStride"),
+                  stride[0], stride[1], stride[2]);
+      particleInitShader.setUniform("u_Stage", 0);
+      for (int round = 0; round < BLUE_NOISE_ROUNDS; round++) {
+        particleInitShader.setUniform("u_Round", round);
+        for (int pz = 0; pz < stride[2]; pz++) {
+          for (int py = 0; py < stride[1]; py++) {
+            for (int px = 0; px < stride[0]; px++) {
+              glUniform3i(particleInitShader.getUniformLocation("u_Phase"), px,
+                          py, pz);
+              int phaseCells = 1;
+              int phase[3] = {px, py, pz};
+              for (int a = 0; a < 3; a++) {
+                phaseCells *= (dims[a] - phase[a] + stride[a] - 1) / stride[a];
+              }
+              particleInitShader.dispatch((phaseCells + 255) / 256, 1, 1);
+              particleInitShader.wait();
+            }
+          }
+        }
+      }
+
+      // Histogram, cutoff, histogram of the cutoff bin, cutoff, write out.
+      for (int stage = 1; stage <= 5; stage++) {
+        particleInitShader.setUniform("u_Stage", stage);
+        particleInitShader.dispatch(stage % 2 == 0 ? 1 : (cells + 255) / 256,
+                                    1, 1);
+        particleInitShader.wait();
+      }
+    } else {
+      particleInitShader.bindBuffer("DartGrid", dartGrid, 2);
+      glUniform3i(particleInitShader.getUniformLocation("u_GridDims"), 1, 1, 1);
+    }
+
+    particleInitShader.setUniform("u_Stage", 6);
+    particleInitShader.dispatch((params.maxParticles + 255) / 256, 1, 1);
+    particleInitShader.wait();
+    if (dims[0] * dims[1] * dims[2] > 1) dartGrid.resize(1);
+  }
+
+  // Streaming worlds can be far larger than the GPU buffers and page most
+  // particles straight to the chunk store, so they are built on the host.
+  int generateStreamingParticles() {
+    int slots = std::max(params.maxParticles, params.numParticles);
+    std::vector<float> data(static_cast<size_t>(slots) * PARTICLE_FLOATS);
 
 
 #pragma omp parallel
@@ -789,8 +2191,8 @@ class ParticleLeniaSimulation {
       std::uniform_real_distribution<float> dnaDist(-0.2f, 0.2f);
 
 #pragma omp for
-      for (int i = 0; i < params.maxParticles; i++) {
-        int base = i * PARTICLE_FLOATS;
+      for (int i = 0; i < slots; i++) {
+        size_t base = static_cast<size_t>(i) * PARTICLE_FLOATS;
         if (i < params.numParticles) {
           
           data[base + 0] = posDistX(localRng);
@@ -819,17 +2221,400 @@ class ParticleLeniaSimulation {
       }
     }
 
+    int resident = 0;
+    pageParticles(data, false, resident);
+    if (resident > params.maxParticles) setCapacity(resident);
+    data.resize(static_cast<size_t>(params.maxParticles) * PARTICLE_FLOATS,
+                0.0f);
+    particleBufferA.setData(data);
+    particleBufferB.setData(data);
+    return resident;
+  }
+
+  int chunkCountFor(float extent) const {
+    return std::clamp(
+        static_cast<int>(extent / std::max(params.chunkSize, 1.0f)), 1, 4096);
+  }
+
+  void resetChunks() {
+    chunkCounts[0] = chunkCountFor(params.worldWidth);
+    chunkCounts[1] = chunkCountFor(params.worldHeight);
+    chunkStore.reset(chunkCounts[0] * chunkCounts[1]);
+    stepsSinceStream = 0;
+    residentChunks = chunkCounts[0] * chunkCounts[1];
+    storedParticles = 0;
+    lastFocus[0] = params.translateX;
+    lastFocus[1] = params.translateY;
+    focusDrift[0] = focusDrift[1] = 0.0f;
+  }
+
+  // Wraps around the periodic world, so predictions past an edge land on
+  // the far side.
+  int chunkIndex(float x, float y) const {
+    int c[2];
+    float pos[2] = {x, y};
+    float extent[2] = {params.worldWidth, params.worldHeight};
+    for (int a = 0; a < 2; a++) {
+      int cell = static_cast<int>(
+          std::floor((pos[a] / extent[a] + 0.5f) * chunkCounts[a]));
+      c[a] = (cell % chunkCounts[a] + chunkCounts[a]) % chunkCounts[a];
+    }
+    return c[1] * chunkCounts[0] + c[0];
+  }
+
+  // Sets flags for every chunk within radius chunks of (x, y).
+  void markChunks(float x, float y, int radius, std::vector<uint8_t>& flags) {
+    int centre = chunkIndex(x, y);
+    int cx = centre % chunkCounts[0];
+    int cy = centre / chunkCounts[0];
+    int rx = std::min(radius, chunkCounts[0] / 2);
+    int ry = std::min(radius, chunkCounts[1] / 2);
+    for (int dy = -ry; dy <= ry; dy++) {
+      int y2 = ((cy + dy) % chunkCounts[1] + chunkCounts[1]) % chunkCounts[1];
+      for (int dx = -rx; dx <= rx; dx++) {
+        int x2 = ((cx + dx) % chunkCounts[0] + chunkCounts[0]) % chunkCounts[0];
+        flags[y2 * chunkCounts[0] + x2] = 1;
+      }
+    }
+  }
+
+  // Pages particles between data and chunkStore. Chunks in view (plus
+  // residentMargin) or holding particles faster than activeSpeed, and the
+  // ring around those, are loaded; chunks one ring further are kept if
+  // already resident, which stops chunks at the boundary from thrashing.
+  // Chunks the view or an active cluster is heading for are prefetched.
+  // On return the first `resident` particles of data are the ones left to
+  // simulate. Returns whether any particle moved in or out.
+  bool pageParticles(std::vector<float>& data, bool loadAll, int& resident) {
+    int slots = static_cast<int>(data.size() / PARTICLE_FLOATS);
+    int chunks = chunkCounts[0] * chunkCounts[1];
+    std::vector<int> chunkOf(slots, -1);
+    std::vector<int> population(chunks, 0);
+    std::vector<float> speed(chunks, 0.0f);
+    std::vector<float> drift(chunks * 2, 0.0f);
+    for (int i = 0; i < slots; i++) {
+      const float* p = &data[static_cast<size_t>(i) * PARTICLE_FLOATS];
+      if (p[6] < 0.01f) continue;
+      int c = chunkIndex(p[0], p[1]);
+      chunkOf[i] = c;
+      population[c]++;
+      speed[c] += std::sqrt(p[3] * p[3] + p[4] * p[4] + p[5] * p[5]);
+      drift[c * 2] += p[3];
+      drift[c * 2 + 1] += p[4];
+    }
+
+    std::vector<uint8_t> load(chunks, loadAll ? 1 : 0);
+    std::vector<uint8_t> keep(chunks, loadAll ? 1 : 0);
+    std::vector<uint8_t> ahead(chunks, 0);
+    if (!loadAll) {
+      float viewExtent =
+          0.5f * std::max(params.worldWidth, params.worldHeight) / params.zoom;
+      int viewRadius = params.residentMargin +
+                       static_cast<int>(std::ceil(viewExtent / params.chunkSize));
+      markChunks(params.translateX, params.translateY, viewRadius, load);
+      markChunks(params.translateX, params.translateY, viewRadius + 1, keep);
+      markChunks(params.translateX + 2.0f * focusDrift[0],
+                 params.translateY + 2.0f * focusDrift[1], viewRadius, ahead);
+
+      float lookahead = 2.0f * params.streamInterval * params.dt;
+      for (int c = 0; c < chunks; c++) {
+        if (population[c] == 0 ||
+            speed[c] / population[c] <= params.activeSpeed) {
+          continue;
+        }
+        float x = ((c % chunkCounts[0] + 0.5f) / chunkCounts[0] - 0.5f) *
+                  params.worldWidth;
+        float y = ((c / chunkCounts[0] + 0.5f) / chunkCounts[1] - 0.5f) *
+                  params.worldHeight;
+        markChunks(x, y, 1, load);
+        markChunks(x, y, 2, keep);
+        markChunks(x + drift[c * 2] / population[c] * lookahead,
+                   y + drift[c * 2 + 1] / population[c] * lookahead, 1, ahead);
+      }
+    }
+
+    std::vector<int> leaving;
+    for (int i = 0; i < slots; i++) {
+      if (chunkOf[i] >= 0 && !keep[chunkOf[i]]) leaving.push_back(i);
+    }
+    std::stable_sort(leaving.begin(), leaving.end(),
+                     [&](int a, int b) { return chunkOf[a] < chunkOf[b]; });
+    std::vector<float> block;
+    for (size_t k = 0; k < leaving.size();) {
+      int c = chunkOf[leaving[k]];
+      block.clear();
+      for (; k < leaving.size() && chunkOf[leaving[k]] == c; k++) {
+        const float* p = &data[static_cast<size_t>(leaving[k]) * PARTICLE_FLOATS];
+        block.insert(block.end(), p, p + PARTICLE_FLOATS);
+      }
+      chunkStore.store(c, block.data(),
+                       static_cast<int>(block.size() / PARTICLE_FLOATS));
+    }
+
+    resident = 0;
+    for (int i = 0; i < slots; i++) {
+      if (chunkOf[i] < 0 || !keep[chunkOf[i]]) continue;
+      if (resident != i) {
+        std::copy_n(&data[static_cast<size_t>(i) * PARTICLE_FLOATS],
+                    PARTICLE_FLOATS,
+                    &data[static_cast<size_t>(resident) * PARTICLE_FLOATS]);
+      }
+      resident++;
+    }
+    data.resize(static_cast<size_t>(resident) * PARTICLE_FLOATS);
+
+    int loaded = 0;
+    std::vector<int> prefetch;
+    residentChunks = 0;
+    for (int c = 0; c < chunks; c++) {
+      if (keep[c]) residentChunks++;
+      if (chunkStore.storedCount(c) == 0) continue;
+      if (load[c]) {
+        loaded += chunkStore.take(c, data);
+      } else if (ahead[c]) {
+        prefetch.push_back(c);
+      }
+    }
+    chunkStore.prefetch(prefetch);
+    storedParticles = chunkStore.totalStored();
+
+    resident += loaded;
+    return !leaving.empty() || loaded > 0;
+  }
+
+  // Frees a snapshot's staging buffer and its share of the host budget.
+  void dropSnapshot(RewindSnapshot& snap) {
+    if (snap.fence) glDeleteSync(snap.fence);
+    if (snap.staging) glDeleteBuffers(1, &snap.staging);
+    rewindHostBytes -= snap.host.size() * sizeof(uint32_t);
+    snap = RewindSnapshot();
+  }
+
+  void resetRewind() {
+    for (RewindSnapshot& snap : rewindSnapshots) dropSnapshot(snap);
+    rewindSnapshots.clear();
+    if (rewindRing) glDeleteBuffers(1, &rewindRing);
+    rewindRing = 0;
+    rewindSlots = 0;
+    rewindSlotBytes = 0;
+    rewindHostBytes = 0;
+    rewindCursor = -1;
+    stepsSinceSnapshot = 0;
+  }
+
+  // Slots are sized for the current capacity, so growing or shrinking the
+  // particle buffers, or changing the GPU budget, starts a fresh history.
+  void ensureRewindRing() {
+    size_t slotBytes = static_cast<size_t>(params.maxParticles) * 8 * 4 +
+                       static_cast<size_t>(foodGridSize) * foodGridSize * 2 * 4;
+    slotBytes = (slotBytes + 255) / 256 * 256;
+    size_t budget = static_cast<size_t>(std::max(params.rewindGpuMB, 1)) << 20;
+    int slots = static_cast<int>(
+        std::clamp<size_t>(budget / slotBytes, 1, 1024));
+    if (rewindRing && slotBytes == rewindSlotBytes && slots == rewindSlots) {
+      return;
+    }
+
+    resetRewind();
+    rewindSlotBytes = slotBytes;
+    rewindSlots = slots;
+    glGenBuffers(1, &rewindRing);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, rewindRing);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, rewindSlotBytes * rewindSlots,
+                 nullptr, GL_DYNAMIC_COPY);
+    if (!rewindUpload) glGenBuffers(1, &rewindUpload);
+  }
+
+  // Reads a spilled snapshot into host memory. Without wait it only does so
+  // once the copy has finished on the GPU.
+  bool finishSpill(RewindSnapshot& snap, bool wait) {
+    if (!snap.fence) return true;
+    GLenum status = glClientWaitSync(snap.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      return false;
+    }
+    snap.host.resize(rewindSlotBytes / sizeof(uint32_t));
+    glBindBuffer(GL_COPY_READ_BUFFER, snap.staging);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, rewindSlotBytes,
+                       snap.host.data());
+    Buffer::countRead(rewindSlotBytes);
+    glDeleteSync(snap.fence);
+    glDeleteBuffers(1, &snap.staging);
+    snap.fence = nullptr;
+    snap.staging = 0;
+    rewindHostBytes += rewindSlotBytes;
+    return true;
+  }
+
+  void bindSnapshotState(size_t snapshotOffset, GLuint buffer) {
+    Buffer& activeBuffer = useBufferA ? particleBufferA : particleBufferB;
+    Buffer& otherBuffer = useBufferA ? particleBufferB : particleBufferA;
+    snapshotShader.use();
+    snapshotShader.bindBuffer("Particles", activeBuffer, 0);
+    snapshotShader.bindBuffer("ParticlesCopy", otherBuffer, 1);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, buffer, snapshotOffset,
+                      rewindSlotBytes);
+    glBindImageTexture(0, foodTexture, 0, GL_FALSE, 0, GL_READ_WRITE,
+                       GL_RGBA16F);
+    snapshotShader.setUniform("u_NumParticles", params.maxParticles);
+    snapshotShader.setUniform("u_WorldSize", params.worldWidth,
+                              params.worldHeight, params.worldDepth);
+    snapshotShader.setUniform("u_FoodGridSize", foodGridSize);
+    snapshotShader.setUniform("u_FoodOffset", params.maxParticles * 8);
+  }
+
+  void runSnapshotStages(int particleStage, int foodStage) {
+    snapshotShader.setUniform("u_Stage", particleStage);
+    snapshotShader.dispatch((params.maxParticles + 255) / 256, 1, 1);
+    snapshotShader.setUniform("u_Stage", foodStage);
+    snapshotShader.dispatch((foodGridSize * foodGridSize + 255) / 256, 1, 1);
+    snapshotShader.wait();
+  }
+
+  void captureSnapshot() {
+    ensureRewindRing();
+
+    // Take a free slot, or spill the oldest snapshot still on the GPU.
+    std::vector<bool> used(rewindSlots, false);
+    RewindSnapshot* oldest = nullptr;
+    for (RewindSnapshot& snap : rewindSnapshots) {
+      if (snap.gpuSlot < 0) continue;
+      used[snap.gpuSlot] = true;
+      if (!oldest) oldest = &snap;
+    }
+    int slot = static_cast<int>(
+        std::find(used.begin(), used.end(), false) - used.begin());
+    if (slot == rewindSlots) {
+      slot = oldest->gpuSlot;
+      glGenBuffers(1, &oldest->staging);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, oldest->staging);
+      glBufferData(GL_COPY_WRITE_BUFFER, rewindSlotBytes, nullptr,
+                   GL_STREAM_READ);
+      glBindBuffer(GL_COPY_READ_BUFFER, rewindRing);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                          slot * rewindSlotBytes, 0, rewindSlotBytes);
+      oldest->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      oldest->gpuSlot = -1;
+    }
+
+    bindSnapshotState(slot * rewindSlotBytes, rewindRing);
+    runSnapshotStages(0, 1);
+
+    RewindSnapshot snap;
+    snap.step = totalSteps;
+    snap.aliveCount = aliveCount;
+    snap.stepSeed = stepSeed;
+    snap.foodSeed = foodSeed;
+    snap.gpuSlot = slot;
+    rewindSnapshots.push_back(snap);
+    stepsSinceSnapshot = 0;
+  }
+
+  void restoreSnapshot(int index) {
+    ensureRewindRing();
+    if (index < 0 || index >= static_cast<int>(rewindSnapshots.size())) return;
+    RewindSnapshot& snap = rewindSnapshots[index];
+    if (snap.gpuSlot >= 0) {
+      bindSnapshotState(snap.gpuSlot * rewindSlotBytes, rewindRing);
+    } else {
+      finishSpill(snap, true);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, rewindUpload);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, rewindSlotBytes, snap.host.data(),
+                   GL_STREAM_DRAW);
+      bindSnapshotState(0, rewindUpload);
+    }
+    runSnapshotStages(2, 3);
+
+    totalSteps = snap.step;
+    aliveCount = snap.aliveCount;
+    stepSeed = snap.stepSeed;
+    foodSeed = snap.foodSeed;
+    rewindCursor = index;
+    stepsSinceSnapshot = 0;
+    sortPending = true;
+    neighbourListDirty = true;
+    sleepCounters.clear();
+    steadyState.reset();
+    viewVersion++;
+  }
+
+  // Paged-out chunks are not part of a snapshot, so rewind stays off while
+  // streaming.
+  void updateRewind() {
+    for (RewindSnapshot& snap : rewindSnapshots) finishSpill(snap, false);
+    size_t hostBudget =
+        static_cast<size_t>(std::max(params.rewindHostMB, 0)) << 20;
+    while (rewindHostBytes > hostBudget && !rewindSnapshots.empty() &&
+           rewindSnapshots.front().gpuSlot < 0) {
+      dropSnapshot(rewindSnapshots.front());
+      rewindSnapshots.pop_front();
+      if (rewindCursor >= 0) rewindCursor = std::max(rewindCursor - 1, 0);
+    }
+
+    if (!params.rewindEnabled || params.streamingEnabled) {
+      if (!rewindSnapshots.empty()) resetRewind();
+      return;
+    }
+    if (rewindSnapshots.empty() ||
+        stepsSinceSnapshot >= std::max(params.rewindInterval, 1)) {
+      captureSnapshot();
+    }
+  }
+
+  // Runs a paging pass every streamInterval steps. Turning streaming off, or
+  // changing the chunk layout, first brings every stored particle back.
+  void updateStreaming() {
+    bool relayout = chunkCounts[0] != chunkCountFor(params.worldWidth) ||
+                    chunkCounts[1] != chunkCountFor(params.worldHeight);
+    if (relayout && storedParticles == 0) {
+      resetChunks();
+      relayout = false;
+    }
+    bool restore = storedParticles > 0 && (!params.streamingEnabled || relayout);
+    if (!params.streamingEnabled && !restore) return;
+    if (!restore && stepsSinceStream < params.streamInterval) return;
+
+    focusDrift[0] = params.translateX - lastFocus[0];
+    focusDrift[1] = params.translateY - lastFocus[1];
+    lastFocus[0] = params.translateX;
+    lastFocus[1] = params.translateY;
+    stepsSinceStream = 0;
+
+    Buffer& activeBuffer = useBufferA ? particleBufferA : particleBufferB;
+    std::vector<float> data = activeBuffer.getData();
+    int resident = 0;
+    bool moved = pageParticles(data, restore, resident);
+    if (relayout) resetChunks();
+    if (!moved) return;
+
+    if (resident > params.maxParticles) {
+      setCapacity(std::max(resident, params.maxParticles * 2));
+    }
+    data.resize(static_cast<size_t>(params.maxParticles) * PARTICLE_FLOATS,
+                0.0f);
     particleBufferA.setData(data);
     particleBufferB.setData(data);
-    aliveCount = params.numParticles;
+    aliveCount = resident;
+    sortPending = true;
+    neighbourListDirty = true;
+    sleepCounters.clear();
+    viewVersion++;
   }
 
   void step() {
+    if (params.spatialSort && sortPending) {
+      passTimer.begin("sort");
+      sortParticles();
+      passTimer.end("sort");
+    }
+
     Buffer& readBuffer = useBufferA ? particleBufferA : particleBufferB;
     Buffer& writeBuffer = useBufferA ? particleBufferB : particleBufferA;
 
     
     if (params.foodEnabled) {
+      passTimer.begin("food");
       foodUpdateShader.use();
 
       
@@ -837,26 +2622,131 @@ class ParticleLeniaSimulation {
                          GL_RGBA16F);
 
       
-      static int foodFrame = 0;
       foodUpdateShader.setUniform("u_FoodGridSize", foodGridSize);
       foodUpdateShader.setUniform("u_FoodSpawnRate", params.foodSpawnRate);
       foodUpdateShader.setUniform("u_FoodDecayRate", params.foodDecayRate);
       foodUpdateShader.setUniform("u_FoodMaxAmount", params.foodMaxAmount);
-      foodUpdateShader.setUniform("u_RandomSeed", foodFrame++);
+      foodUpdateShader.setUniform("u_RandomSeed", foodSeed++);
 
       
       int foodWorkGroupsX = (foodGridSize + 15) / 16;
       int foodWorkGroupsY = (foodGridSize + 15) / 16;
       foodUpdateShader.dispatch(foodWorkGroupsX, foodWorkGroupsY, 1);
       foodUpdateShader.wait();
+      passTimer.end("food");
+    }
+
+    stepTileSize = std::clamp(params.stepLocalSize, 64, 256) *
+                   std::clamp(params.particlesPerThread, 1, 4);
+    if (params.spatialSort) {
+      computeTileBounds(readBuffer);
+      stepsSinceSort++;
+    }
+    stepsSinceStream++;
+    stepsSinceSnapshot++;
+    totalSteps++;
+    if (rewindCursor >= 0) {
+      // Stepping on from a restored snapshot starts a new branch; the old
+      // future is gone.
+      while (static_cast<int>(rewindSnapshots.size()) > rewindCursor + 1) {
+        dropSnapshot(rewindSnapshots.back());
+        rewindSnapshots.pop_back();
+      }
+      rewindCursor = -1;
+    }
+
+    bool planar = use2DKernel();
+    if (planar != kernel2DActive) {
+      kernel2DActive = planar;
+      neighbourListDirty = true;
+    }
+
+    passTimer.begin("pairs");
+    if (params.pairSearch == 1) {
+      if (!neighbourListDirty) checkNeighbourDisplacement(readBuffer);
+      if (neighbourListDirty || neighbourListRadius != neighbourListRadiusFor()) {
+        buildNeighbourList(readBuffer);
+      }
+      stepsSinceNeighbourBuild++;
+    } else if (params.pairSearch == 2) {
+      buildGrid(grid, interactionCutoff() + params.h, readBuffer, planar);
+    }
+    if (params.splitRepulsion) {
+      buildGrid(fineGrid, 1.0f + params.h, readBuffer, planar);
+    }
+    passTimer.end("pairs");
+
+    if (params.autoTuneKernel) {
+      updateKernelTuning(readBuffer, writeBuffer, planar);
     }
 
+    ComputeShader& stepKernelShader = stepKernels.get(stepKernelDefines(
+        planar, params.stepLocalSize, params.particlesPerThread));
+    bindStepKernel(stepKernelShader, readBuffer, writeBuffer);
+
+    
+    stepKernelShader.setUniform("u_RandomSeed", stepSeed++);
+
     
-    stepShader.use();
+    passTimer.begin("step");
+    stepKernelShader.dispatch(stepTileCount(), 1, 1);
+    stepKernelShader.wait();
+    passTimer.end("step");
+
+    useBufferA = !useBufferA;
+    viewVersion++;
+  }
+
+  // A grid's three step-kernel blocks sit at consecutive bindings from
+  // first: cell ranges (or hash keys and ranges), then the entries.
+  void bindCellGrid(ComputeShader& shader, CellGrid& g,
+                    const std::string& prefix, GLuint first) {
+    if (g.hashed) {
+      shader.bindBuffer(prefix + "HashKeys", g.hashKeys, first);
+      shader.bindBuffer(prefix + "HashRanges", g.hashRanges, first + 1);
+      glUniform1ui(shader.getUniformLocation("u_" + prefix + "HashMask"),
+                   static_cast<GLuint>(g.hashSlots - 1));
+    } else {
+      shader.bindBuffer(prefix + "CellStart", g.cellStart, first);
+      shader.bindBuffer(prefix + "CellEnd", g.cellEnd, first + 1);
+    }
+    shader.bindBuffer(prefix + "Particles", g.entries, first + 2);
+  }
+
+  // Binds every buffer, image and uniform of a step kernel except the
+  // random seed.
+  void bindStepKernel(ComputeShader& stepKernelShader, Buffer& readBuffer,
+                      Buffer& writeBuffer) {
+    stepKernelShader.use();
 
     
-    stepShader.bindBuffer("ParticlesIn", readBuffer, 0);
-    stepShader.bindBuffer("ParticlesOut", writeBuffer, 1);
+    stepKernelShader.bindBuffer("ParticlesIn", readBuffer, 0);
+    stepKernelShader.bindBuffer("ParticlesOut", writeBuffer, 1);
+    stepKernelShader.bindBuffer("TileBounds", tileBounds, 2);
+    stepKernelShader.bindBuffer("NeighbourOffsets", neighbourOffsets, 3);
+    stepKernelShader.bindBuffer("NeighbourIndices", neighbourIndices, 4);
+    stepKernelShader.setUniform("u_UseTileBounds", params.spatialSort);
+    stepKernelShader.setUniform("u_PairSearch", params.pairSearch);
+    if (params.pairSearch == 2) {
+      bindCellGrid(stepKernelShader, grid, "Grid", 7);
+      glUniform3i(stepKernelShader.getUniformLocation("u_GridDims"),
+                  grid.dims[0], grid.dims[1], grid.dims[2]);
+    }
+    if (params.splitRepulsion) {
+      bindCellGrid(stepKernelShader, fineGrid, "Fine", 10);
+      glUniform3i(stepKernelShader.getUniformLocation("u_FineGridDims"),
+                  fineGrid.dims[0], fineGrid.dims[1], fineGrid.dims[2]);
+    }
+
+    // Only awakeCount restarts; births and deaths wait for updateStats().
+    clearStepCounter(STEP_AWAKE);
+    stepKernelShader.bindBuffer("SleepCounters", sleepCounters, 5);
+    stepKernelShader.bindBuffer("StepCounters", stepCounters, 6);
+    stepKernelShader.setUniform("u_SleepEnabled", sleepActive());
+    stepKernelShader.setUniform("u_SleepEpsilon", params.sleepEpsilon);
+    stepKernelShader.setUniform("u_SleepSteps", params.sleepSteps);
+    stepKernelShader.setUniform("u_WakeThreshold", params.wakeThreshold);
+    stepKernelShader.setUniform("u_Cutoff", interactionCutoff() + params.h);
 
     
     if (params.foodEnabled) {
@@ -867,79 +2757,328 @@ class ParticleLeniaSimulation {
     
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, goalTexture);
-    stepShader.setUniform("u_GoalTexture", 1);
-    stepShader.setUniform("u_GoalMode", params.goalMode);
-    stepShader.setUniform("u_GoalStrength", params.goalStrength);
+    stepKernelShader.setUniform("u_GoalTexture", 1);
+    stepKernelShader.setUniform("u_GoalStrength", params.goalStrength);
 
     
-    stepShader.setUniform("u_NumParticles", params.maxParticles);
-    stepShader.setUniform("u_AliveCount", aliveCount);
-    stepShader.setUniform("u_WorldWidth", params.worldWidth);
-    stepShader.setUniform("u_WorldHeight", params.worldHeight);
-    stepShader.setUniform("u_WorldDepth", params.worldDepth);
-    stepShader.setUniform("u_Wk", params.w_k);
-    stepShader.setUniform("u_MuK", params.mu_k);
-    stepShader.setUniform("u_SigmaK2", params.sigma_k2);
-    stepShader.setUniform("u_MuG", params.mu_g);
-    stepShader.setUniform("u_SigmaG2", params.sigma_g2);
-    stepShader.setUniform("u_Crep", params.c_rep);
-    stepShader.setUniform("u_Dt", params.dt);
-    stepShader.setUniform("u_H", params.h);
-    stepShader.setUniform("u_EvolutionEnabled", params.evolutionEnabled);
-    stepShader.setUniform("u_BirthRate", params.birthRate);
-    stepShader.setUniform("u_DeathRate", params.deathRate);
-    stepShader.setUniform("u_MutationRate", params.mutationRate);
-    stepShader.setUniform("u_EnergyDecay", params.energyDecay);
-    stepShader.setUniform("u_EnergyFromGrowth", params.energyFromGrowth);
+    stepKernelShader.setUniform("u_NumParticles", params.maxParticles);
+    stepKernelShader.setUniform("u_AliveCount", aliveCount);
+    stepKernelShader.setUniform("u_WorldWidth", params.worldWidth);
+    stepKernelShader.setUniform("u_WorldHeight", params.worldHeight);
+    stepKernelShader.setUniform("u_WorldDepth", params.worldDepth);
+    stepKernelShader.setUniform("u_Wk", params.w_k);
+    stepKernelShader.setUniform("u_MuK", params.mu_k);
+    stepKernelShader.setUniform("u_SigmaK2", params.sigma_k2);
+    stepKernelShader.setUniform("u_MuG", params.mu_g);
+    stepKernelShader.setUniform("u_SigmaG2", params.sigma_g2);
+    stepKernelShader.setUniform("u_Crep", params.c_rep);
+    stepKernelShader.setUniform("u_Dt", params.dt);
+    stepKernelShader.setUniform("u_H", params.h);
+    stepKernelShader.setUniform("u_BirthRate", params.birthRate);
+    stepKernelShader.setUniform("u_DeathRate", params.deathRate);
+    stepKernelShader.setUniform("u_MutationRate", params.mutationRate);
+    stepKernelShader.setUniform("u_EnergyDecay", params.energyDecay);
+    stepKernelShader.setUniform("u_EnergyFromGrowth", params.energyFromGrowth);
 
     
-    stepShader.setUniform("u_FoodGridSize", foodGridSize);
-    stepShader.setUniform("u_FoodConsumptionRadius",
+    stepKernelShader.setUniform("u_FoodGridSize", foodGridSize);
+    stepKernelShader.setUniform("u_FoodConsumptionRadius",
                           params.foodConsumptionRadius);
+  }
 
-    
-    static int frame = 0;
-    stepShader.setUniform("u_RandomSeed", frame++);
+  // originX/originY is the lower-left corner of the viewport being drawn
+  // into, when it is not the whole window.
+  void display(int windowWidth, int windowHeight, int originX = 0,
+               int originY = 0) {
+    Buffer& activeBuffer = useBufferA ? particleBufferA : particleBufferB;
+
+    tiledRasterActive = useTiledRaster(windowWidth, windowHeight) &&
+                        rasterizeTiles(activeBuffer, windowWidth, windowHeight);
+
+    RenderShader& displayShader = displayPrograms.get(displayDefines());
+    displayShader.use();
+    displayShader.bindBuffer("Particles", activeBuffer, 0);
 
     
-    int workGroups = (params.maxParticles + 127) / 128;
-    stepShader.dispatch(workGroups, 1, 1);
-    stepShader.wait();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, foodTexture);
+    displayShader.setUniform("u_FoodTexture", 0);
 
-    useBufferA = !useBufferA;
+    displayShader.setUniform("u_NumParticles", params.maxParticles);
+    displayShader.setUniform("u_WorldWidth", params.worldWidth);
+    displayShader.setUniform("u_WorldHeight", params.worldHeight);
+    displayShader.setUniform("u_TranslateX", params.translateX);
+    displayShader.setUniform("u_TranslateY", params.translateY);
+    displayShader.setUniform("u_Zoom", params.zoom);
+    displayShader.setUniform("u_WindowWidth", static_cast<float>(windowWidth));
+    displayShader.setUniform("u_WindowHeight",
+                             static_cast<float>(windowHeight));
+    glUniform2f(displayShader.getUniformLocation("u_ViewportOrigin"),
+                static_cast<float>(originX), static_cast<float>(originY));
+    displayShader.setUniform("u_Wk", params.w_k);
+    displayShader.setUniform("u_MuK", params.mu_k);
+    displayShader.setUniform("u_SigmaK2", params.sigma_k2);
+    displayShader.setUniform("u_MuG", params.mu_g);
+    displayShader.setUniform("u_SigmaG2", params.sigma_g2);
+    displayShader.setUniform("u_FoodGridSize", foodGridSize);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, splatImage);
+    displayShader.setUniform("u_ParticleImage", 2);
+
+    displayShader.render();
+
+    if (!tiledRasterActive) {
+      renderSplats(activeBuffer, windowWidth, windowHeight);
+    }
   }
 
-  void display(int windowWidth, int windowHeight) {
-    Buffer& activeBuffer = useBufferA ? particleBufferA : particleBufferB;
+  float splatRadiusPixels(int windowWidth, int windowHeight) const {
+    float windowAspect =
+        static_cast<float>(windowWidth) / static_cast<float>(windowHeight);
+    float worldAspect = params.worldWidth / params.worldHeight;
+    float aspectX = windowAspect > worldAspect ? windowAspect / worldAspect : 1.0f;
+    float aspectY = windowAspect > worldAspect ? 1.0f : worldAspect / windowAspect;
+    float pxPerWorld =
+        std::max(windowWidth / (params.worldWidth * aspectX),
+                 windowHeight / (params.worldHeight * aspectY)) *
+        params.zoom;
+    return 0.5f / params.zoom * pxPerWorld;
+  }
 
-    displayShader.use();
-    displayShader.bindBuffer("Particles", activeBuffer, 0);
+  // Instanced splats overdraw badly once many particles share each pixel, so
+  // auto mode switches to the tile-binned compute rasteriser when the summed
+  // splat area exceeds a few times the screen.
+  bool useTiledRaster(int windowWidth, int windowHeight) const {
+    if (params.particleRenderer == 1) return false;
+    if (params.particleRenderer == 2) return true;
+
+    float diameter = 2.0f * splatRadiusPixels(windowWidth, windowHeight);
+    float overdraw = aliveCount * diameter * diameter /
+                     static_cast<float>(windowWidth * windowHeight);
+    return overdraw > 4.0f;
+  }
+
+  void resizeTileRaster(int windowWidth, int windowHeight) {
+    int tilesX = (windowWidth + 15) / 16;
+    int tilesY = (windowHeight + 15) / 16;
+    int numTiles = tilesX * tilesY;
+
+    if (windowWidth != splatImageWidth || windowHeight != splatImageHeight) {
+      if (splatImage == 0) glGenTextures(1, &splatImage);
+      glBindTexture(GL_TEXTURE_2D, splatImage);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, windowWidth, windowHeight, 0,
+                   GL_RGBA, GL_FLOAT, nullptr);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glBindTexture(GL_TEXTURE_2D, 0);
+      splatImageWidth = windowWidth;
+      splatImageHeight = windowHeight;
+
+      splatTileCounts.cleanup();
+      splatTileCounts = Buffer(numTiles, GL_SHADER_STORAGE_BUFFER);
+      splatTileCounts.init();
+      splatTileOffsets.cleanup();
+      splatTileOffsets = Buffer(numTiles + 1, GL_SHADER_STORAGE_BUFFER);
+      splatTileOffsets.init();
+    }
+
+    // A first guess that skips most regrowth; readSplatTotals() grows the
+    // entries to the counted total, periodic images included.
+    int tilesPerAxis =
+        static_cast<int>(2.0f * splatRadiusPixels(windowWidth, windowHeight) /
+                         16.0f) + 2;
+    long long wanted = static_cast<long long>(params.maxParticles) *
+                       tilesPerAxis * tilesPerAxis;
+    growTileEntries(std::min(wanted, 16LL << 20));
+  }
+
+  // False if count entries would not fit in one storage block.
+  bool growTileEntries(long long count) {
+    if (count <= splatEntryCapacity) return true;
+    GLint64 maxBlock = 0;
+    glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlock);
+    long long limit = std::min<long long>(maxBlock / sizeof(GLuint),
+                                          std::numeric_limits<int>::max());
+    if (count > limit) return false;
+    int capacity = static_cast<int>(std::min(count + count / 4, limit));
+    splatTileEntries = Buffer(capacity, GL_SHADER_STORAGE_BUFFER);
+    splatTileEntries.init();
+    splatEntryCapacity = capacity;
+    return true;
+  }
+
+  void releaseSplatReadback() {
+    for (GLsync& fence : splatTotalFences) {
+      if (fence) glDeleteSync(fence);
+      fence = nullptr;
+    }
+    if (splatTotalReadback) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, splatTotalReadback);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      glDeleteBuffers(1, &splatTotalReadback);
+    }
+    splatTotalReadback = 0;
+    splatTotalMapped = nullptr;
+  }
+
+  // Grows the entries to every entry total that has landed, without
+  // waiting for any still in flight.
+  void readSplatTotals() {
+    for (int k = 0; k < SPLAT_TOTAL_SLOTS; k++) {
+      int slot = (splatTotalNext + k) % SPLAT_TOTAL_SLOTS;
+      GLsync& fence = splatTotalFences[slot];
+      if (!fence) continue;
+      GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      // Totals land in order, so none after this one is ready either.
+      if (status == GL_TIMEOUT_EXPIRED) break;
+      splatEntriesFit = growTileEntries(splatTotalMapped[slot]);
+      Buffer::countRead(sizeof(uint32_t));
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+
+  // Copies this frame's entry total out of the prefix sum. With the ring
+  // full the frame goes unmeasured rather than waiting for a slot.
+  void queueSplatTotal(int numTiles) {
+    GLsync& fence = splatTotalFences[splatTotalNext];
+    if (fence) return;
+    glBindBuffer(GL_COPY_READ_BUFFER, splatTileOffsets.getId());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, splatTotalReadback);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        numTiles * sizeof(uint32_t),
+                        splatTotalNext * sizeof(uint32_t), sizeof(uint32_t));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    splatTotalNext = (splatTotalNext + 1) % SPLAT_TOTAL_SLOTS;
+  }
+
+  // Bins every particle's glow footprint into 16x16 screen tiles (count,
+  // prefix sum, fill), then one workgroup per tile composites only the
+  // particles in its own list from shared memory into splatImage. The entry
+  // buffer is sized from the totals of earlier frames; a frame whose total
+  // outgrew it drops the entries past the end, and the next frames draw
+  // in full once the growth lands. False, leaving the frame to the instanced
+  // splats, while the last total is past what one storage block can hold.
+  bool rasterizeTiles(const Buffer& activeBuffer, int windowWidth,
+                      int windowHeight) {
+    resizeTileRaster(windowWidth, windowHeight);
+    readSplatTotals();
+    int tilesX = (windowWidth + 15) / 16;
+    int tilesY = (windowHeight + 15) / 16;
+    int numTiles = tilesX * tilesY;
+
+    splatBinShader.use();
+    splatBinShader.bindBuffer("Particles", activeBuffer, 0);
+    splatBinShader.bindBuffer("TileCounts", splatTileCounts, 1);
+    splatBinShader.bindBuffer("TileOffsets", splatTileOffsets, 2);
+    splatBinShader.bindBuffer("TileEntries", splatTileEntries, 3);
+    splatBinShader.setUniform("u_NumParticles", params.maxParticles);
+    splatBinShader.setUniform("u_EntryCapacity", splatEntryCapacity);
+    splatBinShader.setUniform("u_TilesX", tilesX);
+    splatBinShader.setUniform("u_TilesY", tilesY);
+    splatBinShader.setUniform("u_WorldWidth", params.worldWidth);
+    splatBinShader.setUniform("u_WorldHeight", params.worldHeight);
+    splatBinShader.setUniform("u_TranslateX", params.translateX);
+    splatBinShader.setUniform("u_TranslateY", params.translateY);
+    splatBinShader.setUniform("u_Zoom", params.zoom);
+    splatBinShader.setUniform("u_WindowWidth", static_cast<float>(windowWidth));
+    splatBinShader.setUniform("u_WindowHeight",
+                              static_cast<float>(windowHeight));
+
+    int particleGroups = (params.maxParticles + 255) / 256;
+    splatTileCounts.clear();
+    splatBinShader.setUniform("u_FillPass", false);
+    splatBinShader.dispatch(particleGroups, 1, 1);
+    splatBinShader.wait();
+
+    prefixSumShader.use();
+    prefixSumShader.bindBuffer("Counts", splatTileCounts, 0);
+    prefixSumShader.bindBuffer("Offsets", splatTileOffsets, 1);
+    prefixSumShader.setUniform("u_Count", numTiles);
+    prefixSumShader.dispatch(1, 1, 1);
+    prefixSumShader.wait();
+
+    // Still counted while it does not fit, so it can recover once the total
+    // shrinks again (zooming out, say).
+    queueSplatTotal(numTiles);
+    if (!splatEntriesFit) return false;
+
+    splatTileCounts.clear();
+    splatBinShader.use();
+    splatBinShader.bindBuffer("Particles", activeBuffer, 0);
+    splatBinShader.bindBuffer("TileCounts", splatTileCounts, 1);
+    splatBinShader.bindBuffer("TileOffsets", splatTileOffsets, 2);
+    splatBinShader.bindBuffer("TileEntries", splatTileEntries, 3);
+    splatBinShader.setUniform("u_FillPass", true);
+    splatBinShader.dispatch(particleGroups, 1, 1);
+    splatBinShader.wait();
+
+    splatRasterShader.use();
+    splatRasterShader.bindBuffer("Particles", activeBuffer, 0);
+    splatRasterShader.bindBuffer("TileOffsets", splatTileOffsets, 2);
+    splatRasterShader.bindBuffer("TileEntries", splatTileEntries, 3);
+    glBindImageTexture(0, splatImage, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_RGBA16F);
+    splatRasterShader.setUniform("u_EntryCapacity", splatEntryCapacity);
+    splatRasterShader.setUniform("u_TilesX", tilesX);
+    splatRasterShader.setUniform("u_WorldWidth", params.worldWidth);
+    splatRasterShader.setUniform("u_WorldHeight", params.worldHeight);
+    splatRasterShader.setUniform("u_TranslateX", params.translateX);
+    splatRasterShader.setUniform("u_TranslateY", params.translateY);
+    splatRasterShader.setUniform("u_Zoom", params.zoom);
+    splatRasterShader.setUniform("u_WindowWidth",
+                                 static_cast<float>(windowWidth));
+    splatRasterShader.setUniform("u_WindowHeight",
+                                 static_cast<float>(windowHeight));
+    splatRasterShader.dispatch(tilesX, tilesY, 1);
+    splatRasterShader.wait();
+    return true;
+  }
+
+  // Each live particle is drawn as a screen-space quad covering its glow
+  // radius. The fragment depth is the distance to the particle centre, so a
+  // depth-only pass followed by an LEQUAL colour pass keeps only the nearest
+  // particle per pixel, matching the old per-pixel nearest-particle search.
+  void renderSplats(const Buffer& activeBuffer, int windowWidth,
+                    int windowHeight) {
+    splatShader.use();
+    splatShader.bindBuffer("Particles", activeBuffer, 0);
+
+    splatShader.setUniform("u_WorldWidth", params.worldWidth);
+    splatShader.setUniform("u_WorldHeight", params.worldHeight);
+    splatShader.setUniform("u_TranslateX", params.translateX);
+    splatShader.setUniform("u_TranslateY", params.translateY);
+    splatShader.setUniform("u_Zoom", params.zoom);
+    splatShader.setUniform("u_WindowWidth", static_cast<float>(windowWidth));
+    splatShader.setUniform("u_WindowHeight",
+                           static_cast<float>(windowHeight));
+
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindVertexArray(particleVAO);
+
+    
+    glDepthFunc(GL_LESS);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, params.maxParticles * 4);
 
     
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, foodTexture);
-    displayShader.setUniform("u_FoodTexture", 0);
-
-    displayShader.setUniform("u_NumParticles", params.maxParticles);
-    displayShader.setUniform("u_WorldWidth", params.worldWidth);
-    displayShader.setUniform("u_WorldHeight", params.worldHeight);
-    displayShader.setUniform("u_TranslateX", params.translateX);
-    displayShader.setUniform("u_TranslateY", params.translateY);
-    displayShader.setUniform("u_Zoom", params.zoom);
-    displayShader.setUniform("u_WindowWidth", static_cast<float>(windowWidth));
-    displayShader.setUniform("u_WindowHeight",
-                             static_cast<float>(windowHeight));
-    displayShader.setUniform("u_Wk", params.w_k);
-    displayShader.setUniform("u_MuK", params.mu_k);
-    displayShader.setUniform("u_SigmaK2", params.sigma_k2);
-    displayShader.setUniform("u_MuG", params.mu_g);
-    displayShader.setUniform("u_SigmaG2", params.sigma_g2);
-    displayShader.setUniform("u_ShowFields", params.showFields);
-    displayShader.setUniform("u_FieldType", params.fieldType);
-    displayShader.setUniform("u_ShowFood", params.showFood);
-    displayShader.setUniform("u_FoodGridSize", foodGridSize);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, params.maxParticles * 4);
 
-    displayShader.render();
+    glBindVertexArray(0);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_DEPTH_TEST);
   }
 
   void display3D(int windowWidth, int windowHeight) {
@@ -1074,10 +3213,9 @@ class ParticleLeniaSimulation {
     glDisable(GL_DEPTH_TEST);
   }
 
-  void updateStats() {
-    Buffer& activeBuffer = useBufferA ? particleBufferA : particleBufferB;
-    std::vector<float> data = activeBuffer.getData();
-
+  // Live count and mean energy and age of a readback of the particles.
+  void measureParticles(const std::vector<float>& data, int& alive,
+                        float& meanEnergy, float& meanAge) const {
     int localAliveCount = 0;
     float totalEnergy = 0.0f;
     float totalAge = 0.0f;
@@ -1095,9 +3233,26 @@ class ParticleLeniaSimulation {
       }
     }
 
-    aliveCount = localAliveCount;
-    avgEnergy = aliveCount > 0 ? totalEnergy / aliveCount : 0.0f;
-    avgAge = aliveCount > 0 ? totalAge / aliveCount : 0.0f;
+    alive = localAliveCount;
+    meanEnergy = alive > 0 ? totalEnergy / alive : 0.0f;
+    meanAge = alive > 0 ? totalAge / alive : 0.0f;
+  }
+
+  void updateStats() {
+    Buffer& activeBuffer = useBufferA ? particleBufferA : particleBufferB;
+    std::vector<float> data = activeBuffer.getData();
+    measureParticles(data, aliveCount, avgEnergy, avgAge);
+    statsVersion = viewVersion;
+    steadyState.check(data.data(), params.maxParticles,
+                      params.growCapacity ? 0 : params.maxParticles);
+
+    std::vector<float> counters = stepCounters.getData(0, 3);
+    uint32_t counts[3] = {};
+    std::memcpy(counts, counters.data(), sizeof(counts));
+    awakeCount = static_cast<int>(counts[STEP_AWAKE]);
+    births += counts[STEP_BIRTHS];
+    deaths += counts[STEP_DEATHS];
+    stepCounters.clear();
     
     
     historyAlive.push_back((float)aliveCount);
@@ -1105,6 +3260,9 @@ class ParticleLeniaSimulation {
     
     historyEnergy.push_back(avgEnergy);
     if (historyEnergy.size() > historyMaxSize) historyEnergy.erase(historyEnergy.begin());
+
+    if (params.spatialSort) updateSortDrift();
+    updateCapacity();
   }
 
   void addParticle(float x, float y, float z) {
@@ -1137,9 +3295,16 @@ class ParticleLeniaSimulation {
         otherBuffer.setData(data);
 
         aliveCount++;
-        break;
+        viewVersion++;
+        wakeParticles(x, y, z, interactionCutoff());
+        return;
       }
     }
+
+    if (params.growCapacity) {
+      setCapacity(params.maxParticles * 2);
+      addParticle(x, y, z);
+    }
   }
 
   void spawnOrbium(float x, float y, float z) {
@@ -1179,6 +3344,8 @@ class ParticleLeniaSimulation {
     activeBuffer.setData(data);
     Buffer& otherBuffer = useBufferA ? particleBufferB : particleBufferA;
     otherBuffer.setData(data);
+    viewVersion++;
+    wakeParticles(x, y, z, radius);
   }
 };
 
@@ -1186,6 +3353,573 @@ class ParticleLeniaSimulation {
 ParticleLeniaSimulation simulation;
 bool paused = false;
 
+// A/B comparison: every variant steps alongside `simulation`, interleaved
+// dispatch by dispatch, from a copy of its state but with its own physics.
+// Each is drawn in its own column with the main view's camera. Programs
+// are shared between instances, so a variant costs buffers but no compiles.
+std::vector<std::unique_ptr<ParticleLeniaSimulation>> variants;
+int editedPane = 0;
+
+int viewPanes() { return 1 + static_cast<int>(variants.size()); }
+
+ParticleLeniaSimulation& paneSimulation(int pane) {
+  return pane == 0 ? simulation : *variants[pane - 1];
+}
+
+SimulationParams& editedParams() {
+  return paneSimulation(std::min(editedPane, viewPanes() - 1)).params;
+}
+
+void addVariant() {
+  auto variant = std::make_unique<ParticleLeniaSimulation>();
+  variant->params = simulation.params;
+  variant->params.streamingEnabled = false;
+  variant->params.rewindEnabled = false;
+  variant->init();
+  variant->copyStateFrom(simulation);
+  variants.push_back(std::move(variant));
+}
+
+void syncVariants() {
+  for (auto& variant : variants) variant->copyStateFrom(simulation);
+}
+
+// Everything that decides what the view looks at and how, but not what is
+// simulated.
+void copyViewParams(const SimulationParams& from, SimulationParams& to) {
+  to.translateX = from.translateX;
+  to.translateY = from.translateY;
+  to.translateZ = from.translateZ;
+  to.zoom = from.zoom;
+  to.showFields = from.showFields;
+  to.fieldType = from.fieldType;
+  to.showFood = from.showFood;
+  to.view3D = from.view3D;
+  to.cameraAngle = from.cameraAngle;
+  to.cameraRotation = from.cameraRotation;
+  to.cameraDistance = from.cameraDistance;
+  to.heightScale = from.heightScale;
+  to.glowIntensity = from.glowIntensity;
+  to.showWireframe = from.showWireframe;
+  to.ambientLight = from.ambientLight;
+  to.particleSize = from.particleSize;
+  to.particleRenderer = from.particleRenderer;
+  to.showGoal = from.showGoal;
+}
+
+// Scripted control over a local socket (see ControlSocket.h), enabled with
+// --control PATH. Each request is one JSON object naming a "cmd":
+//   set {key, value}, get [{key}], pause, resume, step [{steps}],
+//   reset [{seed}], load {path}, save {path}, spawn {x, y, [z], [kind]},
+//   stats, snapshot [{shm}]
+// and is answered with one line carrying "ok" and the request's "id", if it
+// had one. Requests are applied between frames; "step" requests are spread
+// over frames at up to stepsPerFrame each and answered when their last step
+// is done. A snapshot's particle data follows its line as "bytes" raw
+// bytes, or is written to the named POSIX shared memory object instead.
+ControlSocket control;
+
+struct ScriptedSteps {
+  ControlRequest request;
+  int remaining;
+  int total;
+};
+std::deque<ScriptedSteps> scriptedSteps;
+
+void sendReply(const ControlRequest& request, JsonObject body,
+               std::vector<char> payload = {}) {
+  if (request.has("id")) body.value("id", request.text("id"));
+  control.reply({request.client, body.str(), std::move(payload)});
+}
+
+void sendError(const ControlRequest& request, const std::string& error) {
+  sendReply(request, JsonObject().boolean("ok", false).string("error", error));
+}
+
+// What a socket client may set each parameter to, matching the GUI: slider
+// bounds for Real and Whole, the options of a combo or checkbox for Choice.
+// Extent is a world size, which scenes and scripts take well past the
+// sliders, so it only has to be positive. Keys not listed here have no GUI
+// control and only have to be finite.
+enum class ParamKind { Real, Whole, Choice, Extent };
+
+struct ParamRange {
+  const char* key;
+  double min, max;
+  ParamKind kind;
+};
+
+const ParamRange paramRanges[] = {
+    {"worldWidth", 0.0, 0.0, ParamKind::Extent},
+    {"worldHeight", 0.0, 0.0, ParamKind::Extent},
+    {"worldDepth", 0.0, 0.0, ParamKind::Extent},
+    {"numParticles", 10, 2000000, ParamKind::Whole},
+    {"initPattern", 0, 2, ParamKind::Choice},
+    {"maxParticles", 1, 2000000, ParamKind::Whole},
+    {"growCapacity", 0, 1, ParamKind::Choice},
+    {"cacheView", 0, 1, ParamKind::Choice},
+    {"w_k", 0.001, 0.1, ParamKind::Real},
+    {"mu_k", 0.5, 20.0, ParamKind::Real},
+    {"sigma_k2", 0.1, 10.0, ParamKind::Real},
+    {"mu_g", 0.0, 2.0, ParamKind::Real},
+    {"sigma_g2", 0.001, 0.5, ParamKind::Real},
+    {"c_rep", 0.0, 5.0, ParamKind::Real},
+    {"dt", 0.01, 0.5, ParamKind::Real},
+    {"h", 0.001, 0.1, ParamKind::Real},
+    {"spatialSort", 0, 1, ParamKind::Choice},
+    {"pairSearch", 0, 2, ParamKind::Choice},
+    {"splitRepulsion", 0, 1, ParamKind::Choice},
+    {"gridStorage", 0, 2, ParamKind::Choice},
+    {"stepKernel", 0, 2, ParamKind::Choice},
+    {"stepLocalSize", 64, 256, ParamKind::Choice},
+    {"particlesPerThread", 1, 4, ParamKind::Choice},
+    {"autoTuneKernel", 0, 1, ParamKind::Choice},
+    {"neighbourSkin", 0.1, 5.0, ParamKind::Real},
+    {"sleepEnabled", 0, 1, ParamKind::Choice},
+    {"sleepEpsilon", 0.0, 0.1, ParamKind::Real},
+    {"sleepSteps", 1, 5000, ParamKind::Whole},
+    {"wakeThreshold", 0.0, 0.5, ParamKind::Real},
+    {"streamingEnabled", 0, 1, ParamKind::Choice},
+    {"chunkSize", 5.0, 500.0, ParamKind::Real},
+    {"residentMargin", 0, 8, ParamKind::Whole},
+    {"streamInterval", 1, 1000, ParamKind::Whole},
+    {"activeSpeed", 0.0, 5.0, ParamKind::Real},
+    {"rewindEnabled", 0, 1, ParamKind::Choice},
+    {"rewindInterval", 1, 1000, ParamKind::Whole},
+    {"rewindGpuMB", 1, 4096, ParamKind::Whole},
+    {"rewindHostMB", 0, 65536, ParamKind::Whole},
+    {"evolutionEnabled", 0, 1, ParamKind::Choice},
+    {"birthRate", 0.0, 0.01, ParamKind::Real},
+    {"deathRate", 0.0, 0.01, ParamKind::Real},
+    {"mutationRate", 0.0, 0.5, ParamKind::Real},
+    {"energyDecay", 0.0, 0.01, ParamKind::Real},
+    {"energyFromGrowth", 0.0, 0.1, ParamKind::Real},
+    {"zoom", 0.1, 5.0, ParamKind::Real},
+    {"stepsPerFrame", 1, 50, ParamKind::Whole},
+    {"showFields", 0, 1, ParamKind::Choice},
+    {"fieldType", 0, 4, ParamKind::Choice},
+    {"foodEnabled", 0, 1, ParamKind::Choice},
+    {"foodSpawnRate", 0.0, 0.01, ParamKind::Real},
+    {"foodDecayRate", 0.0, 0.01, ParamKind::Real},
+    {"foodMaxAmount", 0.1, 5.0, ParamKind::Real},
+    {"showFood", 0, 1, ParamKind::Choice},
+    {"view3D", 0, 1, ParamKind::Choice},
+    {"cameraDistance", 10.0, 200.0, ParamKind::Real},
+    {"glowIntensity", 0.0, 3.0, ParamKind::Real},
+    {"showWireframe", 0, 1, ParamKind::Choice},
+    {"particleSize", 1.0, 50.0, ParamKind::Real},
+    {"particleRenderer", 0, 2, ParamKind::Choice},
+    {"interactionMode", 0, 5, ParamKind::Choice},
+    {"brushRadius", 1.0, 50.0, ParamKind::Real},
+    {"forceStrength", 0.0, 5.0, ParamKind::Real},
+    {"goalMode", 0, 4, ParamKind::Choice},
+    {"goalStrength", 0.0, 2.0, ParamKind::Real},
+    {"showGoal", 0, 1, ParamKind::Choice},
+    {"sonificationEnabled", 0, 1, ParamKind::Choice},
+    {"audioVolume", 0.0, 1.0, ParamKind::Real},
+    {"minFrequency", 20.0, 500.0, ParamKind::Real},
+    {"maxFrequency", 200.0, 2000.0, ParamKind::Real},
+    {"maxVoices", 1, 64, ParamKind::Whole},
+};
+
+// False, with error set, when a "set" value is not a finite number, or lies
+// outside its parameter's GUI range. Values are never rewritten, so the echo
+// of a successful set is exactly what the client sent.
+bool checkParam(const std::string& key, const std::string& value,
+                std::string& error) {
+  if (key == "goalImagePath") return true;
+  char* end = nullptr;
+  double v = std::strtod(value.c_str(), &end);
+  if (value.empty() || *end != '\0' || !std::isfinite(v)) {
+    error = "not a finite number: " + key;
+    return false;
+  }
+  for (const ParamRange& range : paramRanges) {
+    if (key != range.key) continue;
+    if (range.kind == ParamKind::Extent) {
+      if (v > 0.0) return true;
+      error = key + " must be greater than 0: " + value;
+      return false;
+    }
+    if (range.kind != ParamKind::Real && v != std::floor(v)) {
+      error = "not an integer: " + key;
+      return false;
+    }
+    bool valid = v >= range.min && v <= range.max;
+    // Workgroup shapes are limited to the shader variants that exist.
+    if (key == "stepLocalSize") valid = v == 64 || v == 128 || v == 256;
+    if (key == "particlesPerThread") valid = v == 1 || v == 2 || v == 4;
+    if (valid) return true;
+    if (range.kind == ParamKind::Choice) {
+      error = "no such option for " + key + ": " + value;
+    } else {
+      std::ostringstream bounds;
+      bounds << key << " must be in [" << range.min << ", " << range.max
+             << "]: " << value;
+      error = bounds.str();
+    }
+    return false;
+  }
+  return true;
+}
+
+void handleControlRequest(const ControlRequest& request) {
+  std::string cmd = request.text("cmd");
+  JsonObject ok;
+  ok.boolean("ok", true);
+
+  if (cmd == "set") {
+    std::string key = request.text("key");
+    std::string value = request.text("value");
+    if (value == "true" || value == "false") value = value == "true" ? "1" : "0";
+    std::string error;
+    if (!request.has("value")) {
+      sendError(request, "missing value");
+      return;
+    }
+    if (!checkParam(key, value, error)) {
+      sendError(request, error);
+      return;
+    }
+    if (!simulation.setParam(key, value)) {
+      sendError(request, "unknown key or bad value: " + key);
+      return;
+    }
+    // As the Goal/Target panel does when its pattern or image changes.
+    if (key == "goalMode" || key == "goalImagePath") {
+      simulation.updateGoalTexture();
+    }
+    // World size and particle counts only take effect on "reset".
+    sendReply(request, ok.string("key", key).value("value", value));
+  } else if (cmd == "get") {
+    std::stringstream lines;
+    simulation.writeParams(lines);
+    std::string key = request.text("key");
+    JsonObject values;
+    std::string line;
+    while (std::getline(lines, line)) {
+      size_t eq = line.find('=');
+      if (!key.empty() && line.substr(0, eq) != key) continue;
+      values.value(line.substr(0, eq), line.substr(eq + 1));
+      if (!key.empty()) {
+        sendReply(request, ok.string("key", key)
+                               .value("value", line.substr(eq + 1)));
+        return;
+      }
+    }
+    if (!key.empty()) {
+      sendError(request, "unknown key: " + key);
+      return;
+    }
+    sendReply(request, ok.raw("params", values.str()));
+  } else if (cmd == "pause" || cmd == "resume") {
+    paused = cmd == "pause";
+    sendReply(request, ok.boolean("paused", paused));
+  } else if (cmd == "step") {
+    int steps = static_cast<int>(request.number("steps", 1.0));
+    if (steps < 1 || steps > 10000000) {
+      sendError(request, "steps must be between 1 and 10000000");
+      return;
+    }
+    scriptedSteps.push_back({request, steps, steps});
+  } else if (cmd == "reset") {
+    // Like the Restart button. A "seed" makes the run repeatable.
+    if (request.has("seed")) {
+      simulation.rng.seed(static_cast<uint32_t>(request.number("seed", 0.0)));
+      simulation.stepSeed = 0;
+      simulation.foodSeed = 0;
+    }
+    bool rebuilt = simulation.sizeChanged();
+    if (rebuilt) {
+      simulation.init();
+    } else {
+      simulation.resetParticles();
+    }
+    syncVariants();
+    sendReply(request, ok.boolean("rebuilt", rebuilt));
+  } else if (cmd == "load" || cmd == "save") {
+    std::string path = request.text("path");
+    bool done = cmd == "load" ? simulation.loadScene(path)
+                              : simulation.saveScene(path);
+    if (!done) {
+      sendError(request, "cannot " + cmd + " " + path);
+      return;
+    }
+    if (cmd == "load") syncVariants();
+    sendReply(request, ok);
+  } else if (cmd == "spawn") {
+    float x = request.number("x", 0.0);
+    float y = request.number("y", 0.0);
+    float z = request.number("z", 0.0);
+    std::string kind = request.text("kind", "particle");
+    if (kind == "orbium") {
+      simulation.spawnOrbium(x, y, z);
+    } else if (kind == "particle") {
+      simulation.addParticle(x, y, z);
+    } else {
+      sendError(request, "kind is \"particle\" or \"orbium\"");
+      return;
+    }
+    sendReply(request, ok);
+  } else if (cmd == "stats") {
+    // The figures from the last regular updateStats(), which also feeds the
+    // steady-state detector and capacity control; calling it here would let
+    // polling change the run. If the particles changed since, they are
+    // measured again from a plain readback.
+    int alive = simulation.aliveCount;
+    float energy = simulation.avgEnergy;
+    float age = simulation.avgAge;
+    if (simulation.statsVersion != simulation.viewVersion) {
+      Buffer& active = simulation.useBufferA ? simulation.particleBufferA
+                                             : simulation.particleBufferB;
+      simulation.measureParticles(active.getData(), alive, energy, age);
+    }
+    sendReply(request,
+              ok.integer("step", simulation.totalSteps)
+                  .integer("alive", alive)
+                  .integer("capacity", simulation.params.maxParticles)
+                  .number("avgEnergy", energy)
+                  .number("avgAge", age)
+                  .integer("births", simulation.births)
+                  .integer("deaths", simulation.deaths)
+                  .string("outcome",
+                          runOutcomeName(simulation.steadyState.outcome()))
+                  .boolean("paused", paused)
+                  .integer("pendingSteps",
+                           scriptedSteps.empty()
+                               ? 0
+                               : scriptedSteps.front().remaining));
+  } else if (cmd == "snapshot") {
+    // Every slot of the particle buffer, PARTICLE_FLOATS little-endian
+    // floats each; dead slots have energy below 0.01.
+    Buffer& active = simulation.useBufferA ? simulation.particleBufferA
+                                           : simulation.particleBufferB;
+    int count = simulation.params.maxParticles;
+    std::vector<float> data = active.getData(0, count * PARTICLE_FLOATS);
+    size_t bytes = data.size() * sizeof(float);
+    ok.integer("step", simulation.totalSteps)
+        .integer("count", count)
+        .integer("stride", PARTICLE_FLOATS)
+        .integer("bytes", bytes);
+    if (request.has("shm")) {
+      std::string name = request.text("shm");
+      std::string error;
+      if (!ControlSocket::writeSharedMemory(name, data.data(), bytes, error)) {
+        sendError(request, "shared memory " + name + ": " + error);
+        return;
+      }
+      sendReply(request, ok.string("shm", name));
+      return;
+    }
+    std::vector<char> payload(bytes);
+    std::memcpy(payload.data(), data.data(), bytes);
+    sendReply(request, ok, std::move(payload));
+  } else {
+    sendError(request, "unknown cmd: " + cmd);
+  }
+}
+
+void drainControl() {
+  ControlRequest request;
+  while (control.next(request)) handleControlRequest(request);
+}
+
+// This frame's share of the oldest "step" request.
+void advanceScriptedSteps() {
+  if (scriptedSteps.empty()) return;
+  ScriptedSteps& front = scriptedSteps.front();
+  int steps = std::min(front.remaining,
+                       std::max(1, simulation.params.stepsPerFrame));
+  for (int i = 0; i < steps; i++) {
+    simulation.step();
+    for (auto& variant : variants) variant->step();
+  }
+  simulation.updateStreaming();
+  simulation.updateRewind();
+  front.remaining -= steps;
+  if (front.remaining > 0) return;
+
+  simulation.updateStats();
+  for (auto& variant : variants) variant->updateStats();
+  sendReply(front.request, JsonObject()
+                               .boolean("ok", true)
+                               .integer("steps", front.total)
+                               .integer("step", simulation.totalSteps)
+                               .integer("alive", simulation.aliveCount));
+  scriptedSteps.pop_front();
+}
+
+// Prometheus metrics for long unattended runs, served on
+// 127.0.0.1:PORT/metrics with --metrics PORT. The main loop only stores
+// atomics here; formatting happens on the server's thread when scraped.
+MetricsRegistry metrics;
+MetricsServer metricsServer;
+
+// NVX_gpu_memory_info reports in KiB; other drivers have no equivalent and
+// only the buffer total is published.
+constexpr GLenum GPU_MEMORY_TOTAL_NVX = 0x9048;
+constexpr GLenum GPU_MEMORY_AVAILABLE_NVX = 0x9049;
+
+bool hasExtension(const char* name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    const char* ext =
+        reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+    if (ext && std::strcmp(ext, name) == 0) return true;
+  }
+  return false;
+}
+
+void publishMetrics(double frameSeconds) {
+  static Metric* frames = metrics.histogram(
+      "chronos_frame_seconds", "Wall time between frames.",
+      {0.002, 0.004, 0.008, 0.0167, 0.0333, 0.05, 0.1, 0.25, 0.5, 1.0});
+  static Metric* steps =
+      metrics.counter("chronos_steps_total", "Simulation steps run.");
+  static Metric* stepRate = metrics.gauge(
+      "chronos_steps_per_second", "Simulation steps over the last second.");
+  static Metric* alive =
+      metrics.gauge("chronos_alive_particles", "Live particles.");
+  static Metric* capacity =
+      metrics.gauge("chronos_particle_capacity", "Particle buffer slots.");
+  static Metric* births =
+      metrics.counter("chronos_births_total", "Particles born.");
+  static Metric* deaths =
+      metrics.counter("chronos_deaths_total", "Particles died.");
+  static Metric* birthRate = metrics.gauge(
+      "chronos_births_per_second", "Births over the last second.");
+  static Metric* deathRate = metrics.gauge(
+      "chronos_deaths_per_second", "Deaths over the last second.");
+  static Metric* readback = metrics.counter(
+      "chronos_readback_bytes_total", "Bytes copied from GPU to host.");
+  static Metric* bufferBytes = metrics.gauge(
+      "chronos_buffer_bytes", "Bytes held in GPU buffers.");
+  static Metric* vram =
+      hasExtension("GL_NVX_gpu_memory_info")
+          ? metrics.gauge("chronos_vram_used_bytes",
+                          "Video memory in use on the device.")
+          : nullptr;
+
+  static int64_t lastSteps = simulation.totalSteps;
+  static int64_t lastBirths = simulation.births;
+  static int64_t lastDeaths = simulation.deaths;
+  static double windowSeconds = 0.0;
+  static int64_t windowSteps = 0, windowBirths = 0, windowDeaths = 0;
+
+  // totalSteps restarts on reset and moves back on rewind; count on from
+  // wherever it now is.
+  int64_t ran = simulation.totalSteps >= lastSteps
+                    ? simulation.totalSteps - lastSteps
+                    : simulation.totalSteps;
+  lastSteps = simulation.totalSteps;
+  int64_t born = simulation.births - lastBirths;
+  int64_t died = simulation.deaths - lastDeaths;
+  lastBirths = simulation.births;
+  lastDeaths = simulation.deaths;
+
+  frames->observe(frameSeconds);
+  steps->add(ran);
+  births->add(born);
+  deaths->add(died);
+  alive->set(simulation.aliveCount);
+  capacity->set(simulation.params.maxParticles);
+  readback->set(Buffer::bytesRead());
+  bufferBytes->set(Buffer::bytesAllocated());
+
+  windowSeconds += frameSeconds;
+  windowSteps += ran;
+  windowBirths += born;
+  windowDeaths += died;
+  if (windowSeconds >= 1.0) {
+    stepRate->set(windowSteps / windowSeconds);
+    birthRate->set(windowBirths / windowSeconds);
+    deathRate->set(windowDeaths / windowSeconds);
+    windowSeconds = 0.0;
+    windowSteps = windowBirths = windowDeaths = 0;
+    if (vram) {
+      GLint total = 0, available = 0;
+      glGetIntegerv(GPU_MEMORY_TOTAL_NVX, &total);
+      glGetIntegerv(GPU_MEMORY_AVAILABLE_NVX, &available);
+      vram->set((total - available) * 1024.0);
+    }
+  }
+
+  GpuTimer& timer = simulation.passTimer;
+  timer.frame();
+  for (size_t i = 0; i < timer.passes().size(); i++) {
+    Metric* pass = metrics.gauge("chronos_gpu_pass_milliseconds",
+                                 "GPU time per pass over a recent frame.",
+                                 "pass=\"" + timer.passes()[i] + "\"");
+    if (pass) pass->set(timer.milliseconds()[i]);
+  }
+}
+
+// Offscreen copy of the last simulation view. Frames where neither the
+// particles nor any parameter nor the window size changed blit it instead
+// of re-running display()/display3D(); ImGui is drawn on top either way.
+struct ViewCache {
+  GLuint framebuffer = 0;
+  GLuint colour = 0;
+  GLuint depth = 0;
+  int width = 0;
+  int height = 0;
+  bool valid = false;
+  int viewVersion = -1;
+  SimulationParams params;
+  int reusedFrames = 0;
+
+  void resize(int w, int h) {
+    if (framebuffer != 0 && w == width && h == height) return;
+    if (framebuffer == 0) {
+      glGenFramebuffers(1, &framebuffer);
+      glGenTextures(1, &colour);
+      glGenRenderbuffers(1, &depth);
+    }
+    width = w;
+    height = h;
+
+    glBindTexture(GL_TEXTURE_2D, colour);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           colour, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              GL_RENDERBUFFER, depth);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    valid = false;
+  }
+
+  // Byte comparison is deliberate: any parameter edit, display or not,
+  // simply costs one redraw.
+  bool upToDate(const ParticleLeniaSimulation& sim) const {
+    return valid && viewVersion == sim.viewVersion &&
+           std::memcmp(&params, &sim.params, sizeof(SimulationParams)) == 0;
+  }
+
+  void store(const ParticleLeniaSimulation& sim) {
+    std::memcpy(&params, &sim.params, sizeof(SimulationParams));
+    viewVersion = sim.viewVersion;
+    valid = true;
+  }
+
+  void present() const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+};
+
+ViewCache viewCache;
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
   glViewport(0, 0, width, height);
   WINDOW_WIDTH = width;
@@ -1230,14 +3964,15 @@ void processInput(GLFWwindow* window) {
   }
 }
 
+// Maps into the main simulation's pane, the leftmost when comparing.
 ImVec2 screenToWorld(float screenX, float screenY) {
-  float windowAspect =
-      static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT);
+  float paneWidth = static_cast<float>(WINDOW_WIDTH) / viewPanes();
+  float windowAspect = paneWidth / static_cast<float>(WINDOW_HEIGHT);
   float worldAspect =
       simulation.params.worldWidth / simulation.params.worldHeight;
 
   
-  float uvX = (screenX / WINDOW_WIDTH - 0.5f) * 2.0f;
+  float uvX = (screenX / paneWidth - 0.5f) * 2.0f;
   float uvY = ((1.0f - screenY / WINDOW_HEIGHT) - 0.5f) * 2.0f;
 
   
@@ -1372,6 +4107,7 @@ void renderUI() {
   
   if (ImGui::Button("Restart", ImVec2(0, 30))) {
     simulation.resetParticles();
+    syncVariants();
   }
   ImGui::SameLine();
   
@@ -1397,7 +4133,17 @@ void renderUI() {
   ImGui::SameLine(); ImGui::Text(" | "); ImGui::SameLine();
   
   
-  ImGui::Text("Particles: %d", simulation.aliveCount);
+  if (simulation.sleepActive()) {
+    ImGui::Text("Particles: %d (%d awake)", simulation.aliveCount,
+                simulation.awakeCount);
+  } else {
+    ImGui::Text("Particles: %d", simulation.aliveCount);
+  }
+  if (simulation.steadyState.outcome() != RunOutcome::Running) {
+    ImGui::SameLine();
+    ImGui::TextDisabled("(%s)",
+                        runOutcomeName(simulation.steadyState.outcome()));
+  }
   ImGui::SameLine();
   ImGui::Text("FPS: %.1f", io.Framerate);
   
@@ -1422,9 +4168,22 @@ void renderUI() {
     ImGui::PopItemWidth();
 
     int numParticles = simulation.params.numParticles;
-    if (ImGui::DragInt("Spawn Count", &numParticles, 5, 10, 1000)) {
+    if (ImGui::DragInt("Spawn Count", &numParticles, 5, 10, 2000000)) {
       simulation.params.numParticles = numParticles;
     }
+    const char* patterns[] = {"Uniform", "Blue Noise", "Orbium Stamps"};
+    ImGui::Combo("Spawn Pattern", &simulation.params.initPattern, patterns, 3);
+    if (simulation.params.streamingEnabled &&
+        simulation.params.initPattern != 0) {
+      ImGui::TextDisabled("Streaming worlds spawn uniformly");
+    } else {
+      ImGui::TextDisabled("Last reset %.2f ms", simulation.resetMilliseconds);
+    }
+
+    ImGui::Checkbox("Grow Capacity", &simulation.params.growCapacity);
+    ImGui::SameLine();
+    ImGui::TextDisabled("%d / %d slots", simulation.aliveCount,
+                        simulation.params.maxParticles);
   }
 
   
@@ -1447,35 +4206,261 @@ void renderUI() {
   }
 
   
+  // With comparison panes open, these edit the pane chosen under Compare.
+  SimulationParams& physics = editedParams();
   if (ImGui::CollapsingHeader("Physics Parameters")) {
     ImGui::TextDisabled("Perception Kernel");
-    ImGui::DragFloat("Sensitivity (w_k)", &simulation.params.w_k, 0.001f, 0.001f,
+    ImGui::DragFloat("Sensitivity (w_k)", &physics.w_k, 0.001f, 0.001f,
                      0.1f, "%.4f");
-    ImGui::DragFloat("Optimal Range (mu_k)", &simulation.params.mu_k, 0.1f, 0.5f,
+    ImGui::DragFloat("Optimal Range (mu_k)", &physics.mu_k, 0.1f, 0.5f,
                      20.0f);
-    ImGui::DragFloat("Variance (sigma_k)", &simulation.params.sigma_k2, 0.05f,
+    ImGui::DragFloat("Variance (sigma_k)", &physics.sigma_k2, 0.05f,
                      0.1f, 10.0f);
 
     ImGui::Spacing();
     ImGui::TextDisabled("Forces");
-    ImGui::DragFloat("Repulsion (c_rep)", &simulation.params.c_rep, 0.1f, 0.0f,
+    ImGui::DragFloat("Repulsion (c_rep)", &physics.c_rep, 0.1f, 0.0f,
                      5.0f);
   }
 
   
   if (ImGui::CollapsingHeader("Growth Dynamics")) {
-    ImGui::DragFloat("Target Density (mu_g)", &simulation.params.mu_g, 0.01f, 0.0f,
+    ImGui::DragFloat("Target Density (mu_g)", &physics.mu_g, 0.01f, 0.0f,
                      2.0f);
-    ImGui::DragFloat("Tolerance (sigma_g)", &simulation.params.sigma_g2, 0.001f,
+    ImGui::DragFloat("Tolerance (sigma_g)", &physics.sigma_g2, 0.001f,
                      0.001f, 0.5f, "%.4f");
   }
 
   
   if (ImGui::CollapsingHeader("Time & Space")) {
-    ImGui::DragFloat("Delta Time (dt)", &simulation.params.dt, 0.01f, 0.01f,
+    ImGui::DragFloat("Delta Time (dt)", &physics.dt, 0.01f, 0.01f,
                      0.5f);
-    ImGui::DragFloat("Space Step (h)", &simulation.params.h, 0.001f, 0.001f,
+    ImGui::DragFloat("Space Step (h)", &physics.h, 0.001f, 0.001f,
                      0.1f, "%.4f");
+
+    ImGui::Checkbox("Rewind", &simulation.params.rewindEnabled);
+    if (simulation.params.rewindEnabled) {
+      ImGui::Indent();
+      ImGui::DragInt("Snapshot Every", &simulation.params.rewindInterval, 1, 1,
+                     1000, "%d steps");
+      ImGui::DragInt("GPU Budget", &simulation.params.rewindGpuMB, 4, 1, 4096,
+                     "%d MB");
+      ImGui::DragInt("RAM Budget", &simulation.params.rewindHostMB, 16, 0,
+                     65536, "%d MB");
+      if (simulation.params.streamingEnabled) {
+        ImGui::TextDisabled("Unavailable while streaming");
+      }
+
+      int count = static_cast<int>(simulation.rewindSnapshots.size());
+      if (count > 0) {
+        int cursor = simulation.rewindCursor >= 0 ? simulation.rewindCursor
+                                                  : count - 1;
+        char label[48];
+        snprintf(label, sizeof(label), "step %lld",
+                 static_cast<long long>(simulation.rewindSnapshots[cursor].step));
+        if (ImGui::SliderInt("Timeline", &cursor, 0, count - 1, label)) {
+          simulation.restoreSnapshot(cursor);
+        }
+        if (ImGui::Button("<<") && cursor > 0) {
+          simulation.restoreSnapshot(cursor - 1);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button(">>") && cursor < count - 1) {
+          simulation.restoreSnapshot(cursor + 1);
+        }
+        ImGui::SameLine();
+        int onGpu = 0;
+        for (const auto& snap : simulation.rewindSnapshots) {
+          onGpu += snap.gpuSlot >= 0;
+        }
+        ImGui::TextDisabled("%d snapshots: %d GPU, %d RAM (%.0f MB)", count,
+                            onGpu, count - onGpu,
+                            simulation.rewindHostBytes / (1024.0f * 1024.0f));
+      }
+      ImGui::Unindent();
+    }
+  }
+
+  if (ImGui::CollapsingHeader("Compare")) {
+    if (ImGui::Button("Add Variant") && viewPanes() < 4) {
+      addVariant();
+      editedPane = viewPanes() - 1;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Sync State")) syncVariants();
+    if (!variants.empty()) {
+      ImGui::SameLine();
+      if (ImGui::Button("Remove Last")) {
+        variants.pop_back();
+        editedPane = std::min(editedPane, viewPanes() - 1);
+      }
+
+      ImGui::TextDisabled("Physics sliders edit:");
+      for (int pane = 0; pane < viewPanes(); pane++) {
+        char label[8];
+        snprintf(label, sizeof(label), "%c", 'A' + pane);
+        ImGui::SameLine();
+        ImGui::RadioButton(label, &editedPane, pane);
+      }
+      for (int pane = 0; pane < viewPanes(); pane++) {
+        const ParticleLeniaSimulation& sim = paneSimulation(pane);
+        ImGui::Text("%c: %d alive, energy %.2f", 'A' + pane, sim.aliveCount,
+                    sim.avgEnergy);
+      }
+    }
+  }
+
+  
+  if (ImGui::CollapsingHeader("Performance")) {
+    ImGui::Checkbox("Cache Idle View", &simulation.params.cacheView);
+    if (simulation.params.cacheView) {
+      ImGui::SameLine();
+      ImGui::TextDisabled("%d frames reused", viewCache.reusedFrames);
+    }
+
+    const char* kernels[] = {"Auto", "3D", "2D"};
+    ImGui::Combo("Step Kernel", &simulation.params.stepKernel, kernels, 3);
+    ImGui::SameLine();
+    ImGui::TextDisabled("%s", simulation.kernel2DActive ? "2D" : "3D");
+
+    ImGui::Checkbox("Auto-tune Kernel", &simulation.params.autoTuneKernel);
+    if (simulation.params.autoTuneKernel) {
+      ImGui::Indent();
+      if (!simulation.tunedWorkload.empty()) {
+        ImGui::TextDisabled("%s: %d x %d (%.2f ms)",
+                            simulation.tunedWorkload.c_str(),
+                            simulation.tunedChoice.localSize,
+                            simulation.tunedChoice.particlesPerThread,
+                            simulation.tunedChoice.milliseconds);
+      }
+      for (const auto& timing : simulation.tuningTimings) {
+        ImGui::TextDisabled("  %3d x %d: %.2f ms", timing.localSize,
+                            timing.particlesPerThread, timing.milliseconds);
+      }
+      if (ImGui::Button("Re-tune Now")) simulation.retunePending = true;
+      ImGui::Unindent();
+    } else {
+      const int localSizes[] = {64, 128, 256};
+      const int perThreadCounts[] = {1, 2, 4};
+      const char* localSizeNames[] = {"64", "128", "256"};
+      const char* perThreadNames[] = {"1", "2", "4"};
+      int localSizeIndex = static_cast<int>(
+          std::find(localSizes, localSizes + 3,
+                    simulation.params.stepLocalSize) -
+          localSizes);
+      int perThreadIndex = static_cast<int>(
+          std::find(perThreadCounts, perThreadCounts + 3,
+                    simulation.params.particlesPerThread) -
+          perThreadCounts);
+      if (ImGui::Combo("Workgroup Size", &localSizeIndex, localSizeNames, 3)) {
+        simulation.params.stepLocalSize = localSizes[localSizeIndex];
+      }
+      if (ImGui::Combo("Particles / Thread", &perThreadIndex, perThreadNames,
+                       3)) {
+        simulation.params.particlesPerThread = perThreadCounts[perThreadIndex];
+      }
+    }
+    ImGui::TextDisabled("Step tile: %d particles", simulation.stepTileSize);
+    ImGui::TextDisabled("Cached programs: %d step, %d display",
+                        static_cast<int>(simulation.stepKernels.size()),
+                        static_cast<int>(simulation.displayPrograms.size()));
+
+    ImGui::Checkbox("Morton Re-sort", &simulation.params.spatialSort);
+    if (simulation.params.spatialSort) {
+      ImGui::Indent();
+      ImGui::TextDisabled("Sorted %d steps ago, drift %.2f",
+                          simulation.stepsSinceSort, simulation.sortDrift);
+      if (ImGui::Button("Re-sort Now")) simulation.sortPending = true;
+      ImGui::Unindent();
+    }
+
+    const char* pairModes[] = {"All Tiles", "Neighbour List", "Uniform Grid"};
+    ImGui::Combo("Pair Search", &simulation.params.pairSearch, pairModes, 3);
+    if (simulation.params.pairSearch == 2) {
+      ImGui::Indent();
+      ImGui::TextDisabled("%d x %d x %d cells%s", simulation.grid.dims[0],
+                          simulation.grid.dims[1], simulation.grid.dims[2],
+                          simulation.grid.hashed ? ", hashed" : "");
+      ImGui::Unindent();
+    }
+    ImGui::Checkbox("Split Repulsion", &simulation.params.splitRepulsion);
+    if (simulation.params.splitRepulsion) {
+      ImGui::Indent();
+      ImGui::TextDisabled("Fine grid %d x %d x %d cells%s",
+                          simulation.fineGrid.dims[0],
+                          simulation.fineGrid.dims[1],
+                          simulation.fineGrid.dims[2],
+                          simulation.fineGrid.hashed ? ", hashed" : "");
+      ImGui::Unindent();
+    }
+    if (simulation.params.pairSearch == 2 ||
+        simulation.params.splitRepulsion) {
+      const char* storageModes[] = {"Auto", "Dense", "Hashed"};
+      ImGui::Combo("Grid Storage", &simulation.params.gridStorage,
+                   storageModes, 3);
+    }
+    if (simulation.params.pairSearch == 1) {
+      ImGui::Indent();
+      ImGui::DragFloat("Skin", &simulation.params.neighbourSkin, 0.05f, 0.1f,
+                       5.0f);
+      ImGui::TextDisabled("%d pairs, built %d steps ago",
+                          simulation.neighbourPairs,
+                          simulation.stepsSinceNeighbourBuild);
+      ImGui::TextDisabled("Max displacement %.3f / %.3f",
+                          simulation.neighbourDisplacement,
+                          0.5f * simulation.params.neighbourSkin);
+      if (ImGui::Button("Verify on CPU")) simulation.verifyNeighbourList();
+      if (simulation.cpuNeighbourPairs >= 0) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("CPU %d pairs", simulation.cpuNeighbourPairs);
+      }
+      ImGui::Unindent();
+    }
+
+    ImGui::Checkbox("Particle Sleeping", &simulation.params.sleepEnabled);
+    if (simulation.params.sleepEnabled) {
+      ImGui::Indent();
+      ImGui::DragFloat("Sleep Epsilon", &simulation.params.sleepEpsilon,
+                       0.0001f, 0.0f, 0.1f, "%.4f");
+      ImGui::DragInt("Sleep After", &simulation.params.sleepSteps, 1, 1, 5000,
+                     "%d steps");
+      ImGui::DragFloat("Wake Threshold", &simulation.params.wakeThreshold,
+                       0.0005f, 0.0f, 0.5f, "%.4f");
+      if (simulation.params.evolutionEnabled) {
+        ImGui::TextDisabled("Inactive while evolution is on");
+      }
+      ImGui::TextDisabled("Awake: %d / %d", simulation.awakeCount,
+                          simulation.aliveCount);
+      ImGui::Unindent();
+    }
+
+    ImGui::Checkbox("World Streaming", &simulation.params.streamingEnabled);
+    if (simulation.params.streamingEnabled) {
+      ImGui::Indent();
+      ImGui::DragFloat("Chunk Size", &simulation.params.chunkSize, 0.5f, 5.0f,
+                       500.0f);
+      ImGui::DragInt("Resident Margin", &simulation.params.residentMargin, 0.1f,
+                     0, 8, "%d chunks");
+      ImGui::DragInt("Page Every", &simulation.params.streamInterval, 1, 1,
+                     1000, "%d steps");
+      ImGui::DragFloat("Active Speed", &simulation.params.activeSpeed, 0.005f,
+                       0.0f, 5.0f, "%.3f");
+      ImGui::TextDisabled("%d x %d chunks, %d resident",
+                          simulation.chunkCounts[0], simulation.chunkCounts[1],
+                          simulation.residentChunks);
+      size_t compressed = simulation.chunkStore.compressedBytes();
+      float ratio = compressed > 0 ? simulation.storedParticles *
+                                         PARTICLE_FLOATS * sizeof(float) /
+                                         static_cast<float>(compressed)
+                                   : 0.0f;
+      ImGui::TextDisabled("Stored: %lld particles, %.1f MB (%.2fx)",
+                          static_cast<long long>(simulation.storedParticles),
+                          compressed / (1024.0f * 1024.0f), ratio);
+      int hits = simulation.chunkStore.prefetchHits();
+      ImGui::TextDisabled("Prefetched loads: %d / %d", hits,
+                          hits + simulation.chunkStore.prefetchMisses());
+      ImGui::Unindent();
+    }
   }
 
   
@@ -1523,17 +4508,22 @@ void renderUI() {
   if (ImGui::CollapsingHeader("Goal/Target")) {
     bool changed = false;
     const char* goalModes[] = {"None", "Circle", "Box", "Text 'HI'",
-                               "Image (BMP)"};
+                               "Image"};
     if (ImGui::Combo("Pattern", &simulation.params.goalMode, goalModes,
                      5)) {
       changed = true;
     }
 
     if (simulation.params.goalMode == 4) {
-      ImGui::InputText("BMP File", simulation.params.goalImagePath, 256);
+      ImGui::InputText("Image File", simulation.params.goalImagePath, 256);
+      ImGui::TextDisabled("BMP, PGM/PPM or TGA");
       if (ImGui::Button("Reload Image")) {
         changed = true;
       }
+      if (simulation.goalLoader.busy()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("Loading...");
+      }
     }
 
     ImGui::DragFloat("Attraction", &simulation.params.goalStrength,
@@ -1562,6 +4552,13 @@ void renderUI() {
       const char* fieldModes[] = {"Off", "Density", "Separation",
                                   "Growth", "Energy"};
       ImGui::Combo("Field Type", &simulation.params.fieldType, fieldModes, 5);
+
+      const char* rendererModes[] = {"Auto", "Splats", "Tiled Raster"};
+      ImGui::Combo("Particle Renderer", &simulation.params.particleRenderer,
+                   rendererModes, 3);
+      ImGui::TextDisabled("Active: %s", simulation.tiledRasterActive
+                                            ? "Tiled Raster"
+                                            : "Splats");
     }
 
     ImGui::DragFloat("Zoom", &simulation.params.zoom, 0.05f, 0.1f, 5.0f);
@@ -1622,11 +4619,260 @@ void renderUI() {
 
   ImGui::End();
 
+  // Pane letters, matching the Compare section. Pane A starts under the
+  // sidebar.
+  if (viewPanes() > 1) {
+    ImDrawList* draw = ImGui::GetForegroundDrawList();
+    for (int pane = 0; pane < viewPanes(); pane++) {
+      float x = io.DisplaySize.x * pane / viewPanes() + (pane == 0 ? 360 : 10);
+      char label[2] = {static_cast<char>('A' + pane), '\0'};
+      draw->AddText(ImVec2(x, topBarHeight + 10),
+                    IM_COL32(230, 230, 230, 255), label);
+    }
+  }
+
   ImGui::Render();
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-int main() {
+// Times every step kernel variant at a fixed particle density over a range
+// of particle counts and prints milliseconds per step, one row per count.
+int runKernelBenchmark() {
+  const int counts[] = {1024, 4096, 16384, 65536};
+  const int variants[][2] = {{128, 1}, {64, 2}, {128, 2},
+                             {128, 4}, {256, 1}, {256, 2}};
+  const int warmupSteps = 5;
+  const int timedSteps = 50;
+
+  std::cout << "particles";
+  for (const auto& v : variants) std::cout << "\t" << v[0] << "x" << v[1];
+  std::cout << "\t(ms/step)" << std::endl;
+
+  for (int count : counts) {
+    ParticleLeniaSimulation bench;
+    float scale =
+        std::sqrt(count / static_cast<float>(bench.params.numParticles));
+    bench.params.worldWidth *= scale;
+    bench.params.worldHeight *= scale;
+    bench.params.numParticles = count;
+    bench.params.maxParticles = count;
+    bench.params.autoTuneKernel = false;
+    bench.init();
+
+    std::cout << count;
+    for (const auto& v : variants) {
+      bench.params.stepLocalSize = v[0];
+      bench.params.particlesPerThread = v[1];
+      for (int i = 0; i < warmupSteps; i++) bench.step();
+      glFinish();
+
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < timedSteps; i++) bench.step();
+      glFinish();
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cout << "\t" << elapsed.count() / timedSteps;
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
+
+// Runs the CPU dynamics once in a single process and once split across
+// `ranks` processes, and reports whether the two agree.
+int runDomainDecomposition(int ranks, int steps) {
+  SimulationParams defaults;
+  const int count = 4000;
+  float scale = std::sqrt(count / static_cast<float>(defaults.numParticles));
+
+  CpuLeniaParams params;
+  params.w_k = defaults.w_k;
+  params.mu_k = defaults.mu_k;
+  params.sigma_k2 = defaults.sigma_k2;
+  params.mu_g = defaults.mu_g;
+  params.sigma_g2 = defaults.sigma_g2;
+  params.c_rep = defaults.c_rep;
+  params.dt = defaults.dt;
+  params.h = defaults.h;
+  params.worldSize[0] = defaults.worldWidth * scale;
+  params.worldSize[1] = defaults.worldHeight * scale;
+  params.worldSize[2] = defaults.worldDepth;
+
+  std::mt19937 rng(1234);
+  std::vector<float> initial(count * PARTICLE_FLOATS, 0.0f);
+  for (int i = 0; i < count; i++) {
+    float* p = &initial[i * PARTICLE_FLOATS];
+    for (int a = 0; a < 3; a++) {
+      std::uniform_real_distribution<float> pos(-params.worldSize[a] / 2.0f,
+                                                params.worldSize[a] / 2.0f);
+      p[a] = pos(rng);
+    }
+    p[6] = 1.0f;
+  }
+
+  std::vector<int> ids(count);
+  for (int i = 0; i < count; i++) ids[i] = i;
+  std::vector<float> reference = initial;
+  std::vector<float> next;
+  CpuLenia single(params);
+  auto start = std::chrono::steady_clock::now();
+  for (int s = 0; s < steps; s++) {
+    single.step(reference, ids, count, next);
+    reference.swap(next);
+  }
+  std::chrono::duration<double, std::milli> singleTime =
+      std::chrono::steady_clock::now() - start;
+
+  std::vector<float> split = initial;
+  DomainDecomposition decomposition(params, ranks, 10);
+  start = std::chrono::steady_clock::now();
+  if (!decomposition.run(split, count, steps)) return 1;
+  std::chrono::duration<double, std::milli> splitTime =
+      std::chrono::steady_clock::now() - start;
+
+  float maxDiff = 0.0f;
+  for (size_t k = 0; k < split.size(); k++) {
+    maxDiff = std::max(maxDiff, std::abs(split[k] - reference[k]));
+  }
+
+  std::cout << count << " particles, " << steps << " steps" << std::endl;
+  std::cout << "1 process: " << singleTime.count() << " ms" << std::endl;
+  std::cout << ranks << " processes: " << splitTime.count() << " ms"
+            << std::endl;
+  const DomainDecomposition::Stats& stats = decomposition.getStats();
+  for (int r = 0; r < ranks; r++) {
+    std::cout << "  rank " << r << ": x [" << stats.bounds[r] << ", "
+              << stats.bounds[r + 1] << ")  owned " << stats.owned[r]
+              << "  halo " << stats.halo[r] << std::endl;
+  }
+  std::cout << "max difference: " << maxDiff
+            << (maxDiff == 0.0f ? " (match)" : "") << std::endl;
+  return maxDiff == 0.0f ? 0 : 1;
+}
+
+// --optimise [displacement|persistence|goal] with optional
+// --generations N, --population N, --particles N, --steps N,
+// --fields a,b,c, --goal image, --checkpoint file and --full-runs (no early
+// stop for settled runs). Prints the best parameters found as scene file
+// lines.
+int runOptimiser(int argc, char** argv) {
+  SimulationParams defaults;
+  OptimiserOptions options;
+  options.base.w_k = defaults.w_k;
+  options.base.mu_k = defaults.mu_k;
+  options.base.sigma_k2 = defaults.sigma_k2;
+  options.base.mu_g = defaults.mu_g;
+  options.base.sigma_g2 = defaults.sigma_g2;
+  options.base.c_rep = defaults.c_rep;
+  options.base.dt = defaults.dt;
+  options.base.h = defaults.h;
+  options.base.worldSize[0] = defaults.worldWidth;
+  options.base.worldSize[1] = defaults.worldHeight;
+  options.base.worldSize[2] = defaults.worldDepth;
+  options.goalPath = defaults.goalImagePath;
+  int generations = 50;
+
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "displacement") {
+      options.fitness = OptimiserFitness::Displacement;
+    } else if (arg == "persistence") {
+      options.fitness = OptimiserFitness::Persistence;
+    } else if (arg == "goal") {
+      options.fitness = OptimiserFitness::GoalOverlap;
+    } else if (arg == "--generations" && hasValue) {
+      generations = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--population" && hasValue) {
+      options.population = std::atoi(argv[++i]);
+    } else if (arg == "--particles" && hasValue) {
+      options.particles = std::max(2, std::atoi(argv[++i]));
+    } else if (arg == "--steps" && hasValue) {
+      options.steps = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--goal" && hasValue) {
+      options.goalPath = argv[++i];
+    } else if (arg == "--full-runs") {
+      options.stopEarly = false;
+    } else if (arg == "--checkpoint" && hasValue) {
+      options.checkpoint = argv[++i];
+    } else if (arg == "--fields" && hasValue) {
+      options.fields.clear();
+      std::stringstream list(argv[++i]);
+      std::string field;
+      while (std::getline(list, field, ',')) options.fields.push_back(field);
+    } else {
+      std::cerr << "Unknown optimiser argument: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  Optimiser optimiser(options);
+  std::string error;
+  if (!optimiser.valid(error)) {
+    std::cerr << "Optimiser: " << error << std::endl;
+    return 1;
+  }
+  if (optimiser.resume()) {
+    std::cout << "Resumed " << options.checkpoint << " at generation "
+              << optimiser.generation() << std::endl;
+  }
+
+  while (optimiser.generation() < generations) {
+    auto start = std::chrono::steady_clock::now();
+    optimiser.runGeneration();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "generation " << optimiser.generation() << ": best "
+              << optimiser.bestFitness() << "  mean "
+              << optimiser.lastMeanFitness() << "  sigma "
+              << optimiser.sigma() << "  (" << elapsed.count() << " s, "
+              << static_cast<int>(optimiser.lastStepFraction() * 100.0f)
+              << "% of steps)";
+    const std::vector<int>& outcomes = optimiser.lastOutcomes();
+    for (int o = 1; o < static_cast<int>(outcomes.size()); o++) {
+      if (outcomes[o] == 0) continue;
+      std::cout << "  " << outcomes[o] << " "
+                << runOutcomeName(static_cast<RunOutcome>(o));
+    }
+    std::cout << std::endl;
+    if (!optimiser.saveCheckpoint()) {
+      std::cerr << "Optimiser: cannot write " << options.checkpoint
+                << std::endl;
+    }
+  }
+
+  CpuLeniaParams best = optimiser.bestParams();
+  std::cout << "w_k=" << best.w_k << "\n"
+            << "mu_k=" << best.mu_k << "\n"
+            << "sigma_k2=" << best.sigma_k2 << "\n"
+            << "mu_g=" << best.mu_g << "\n"
+            << "sigma_g2=" << best.sigma_g2 << "\n"
+            << "c_rep=" << best.c_rep << "\n"
+            << "dt=" << best.dt << std::endl;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && std::strcmp(argv[1], "--optimise") == 0) {
+    return runOptimiser(argc, argv);
+  }
+  if (argc > 2 && std::strcmp(argv[1], "--domains") == 0) {
+    int ranks = std::clamp(std::atoi(argv[2]), 1, 64);
+    int steps = argc > 3 ? std::max(1, std::atoi(argv[3])) : 50;
+    return runDomainDecomposition(ranks, steps);
+  }
+
+  bool benchmark =
+      argc > 1 && std::strcmp(argv[1], "--benchmark-kernels") == 0;
+  std::string controlPath;
+  int metricsPort = 0;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (std::strcmp(argv[i], "--control") == 0) controlPath = argv[i + 1];
+    if (std::strcmp(argv[i], "--metrics") == 0) {
+      metricsPort = std::atoi(argv[i + 1]);
+    }
+  }
+
   
   if (!glfwInit()) {
     std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -1637,6 +4883,7 @@ int main() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);  
+  if (benchmark) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
   GLFWwindow* window =
       glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT,
@@ -1657,6 +4904,13 @@ int main() {
     return -1;
   }
 
+  if (benchmark) {
+    int result = runKernelBenchmark();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return result;
+  }
+
   
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -1669,6 +4923,14 @@ int main() {
   simulation.init();
   simulation.init3D();
 
+  if (!controlPath.empty()) {
+    control.start(controlPath, [] { glfwPostEmptyEvent(); });
+  }
+  bool publishing =
+      metricsPort > 0 && metricsServer.start(metrics, metricsPort);
+  simulation.passTimer.enabled = publishing;
+  auto lastFrame = std::chrono::steady_clock::now();
+
   
   initAudio();
 
@@ -1679,7 +4941,24 @@ int main() {
   
   while (!glfwWindowShouldClose(window)) {
     processInput(window);
-    glfwPollEvents();
+
+    // A minimised window draws nothing; an unfocused one whose paused view
+    // is unchanged wakes a few times a second instead of every vsync.
+    bool iconified = glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+    bool focused = glfwGetWindowAttrib(window, GLFW_FOCUSED);
+    bool idle = paused && scriptedSteps.empty() &&
+                viewCache.upToDate(simulation);
+    if (iconified) {
+      if (paused && scriptedSteps.empty()) {
+        glfwWaitEvents();
+      } else {
+        glfwWaitEventsTimeout(1.0 / 60.0);
+      }
+    } else if (!focused && idle) {
+      glfwWaitEventsTimeout(0.1);
+    } else {
+      glfwPollEvents();
+    }
 
     
     if (!io.WantCaptureMouse) {
@@ -1731,7 +5010,7 @@ int main() {
                simulation.spawnOrbium(worldPos.x, worldPos.y, 0.0f);
            }
       }
-        float dx = (pos.x - panStart.x) / WINDOW_WIDTH *
+        float dx = (pos.x - panStart.x) * viewPanes() / WINDOW_WIDTH *
                    simulation.params.worldWidth * 2.0f / simulation.params.zoom;
         float dy = (pos.y - panStart.y) / WINDOW_HEIGHT *
                    simulation.params.worldHeight * 2.0f /
@@ -1781,16 +5060,30 @@ int main() {
       }
     }
 
+    simulation.pollGoalImage();
+    drainControl();
+    advanceScriptedSteps();
+
     
     if (!paused) {
-      for (int i = 0; i < simulation.params.stepsPerFrame; i++) {
-        simulation.step();
+      int steps = simulation.params.stepsPerFrame;
+      for (auto& variant : variants) {
+        steps = std::max(steps, variant->params.stepsPerFrame);
+      }
+      for (int i = 0; i < steps; i++) {
+        if (i < simulation.params.stepsPerFrame) simulation.step();
+        for (auto& variant : variants) {
+          if (i < variant->params.stepsPerFrame) variant->step();
+        }
       }
+      simulation.updateStreaming();
+      simulation.updateRewind();
 
       
       static int frameCount = 0;
       if (++frameCount % 10 == 0) {
         simulation.updateStats();
+        for (auto& variant : variants) variant->updateStats();
 
         
         if (simulation.params.sonificationEnabled && g_audio.initialized) {
@@ -1808,29 +5101,71 @@ int main() {
       }
     }
 
-    
-    if (simulation.params.view3D) {
-      
-      glClearColor(0.01f, 0.03f, 0.06f, 1.0f);
-    } else {
-      glClearColor(0.0f, 0.02f, 0.05f, 1.0f);
+    if (iconified) continue;
+
+    int panes = viewPanes();
+    for (auto& variant : variants) {
+      copyViewParams(simulation.params, variant->params);
     }
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    bool cacheView = simulation.params.cacheView && panes == 1;
+    if (!cacheView) viewCache.valid = false;
+    if (cacheView) viewCache.resize(WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    if (simulation.params.view3D) {
-      simulation.display3D(WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (cacheView && viewCache.upToDate(simulation)) {
+      viewCache.reusedFrames++;
     } else {
-      simulation.display(WINDOW_WIDTH, WINDOW_HEIGHT);
+      if (cacheView) glBindFramebuffer(GL_FRAMEBUFFER, viewCache.framebuffer);
+
+      // The scissor keeps each pane's clears inside its column.
+      if (panes > 1) glEnable(GL_SCISSOR_TEST);
+      for (int pane = 0; pane < panes; pane++) {
+        ParticleLeniaSimulation& sim = paneSimulation(pane);
+        int x = WINDOW_WIDTH * pane / panes;
+        int width = WINDOW_WIDTH * (pane + 1) / panes - x;
+        glViewport(x, 0, width, WINDOW_HEIGHT);
+        glScissor(x, 0, width, WINDOW_HEIGHT);
+
+        
+        if (sim.params.view3D) {
+          
+          glClearColor(0.01f, 0.03f, 0.06f, 1.0f);
+        } else {
+          glClearColor(0.0f, 0.02f, 0.05f, 1.0f);
+        }
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        simulation.passTimer.begin("render");
+        if (sim.params.view3D) {
+          sim.display3D(width, WINDOW_HEIGHT);
+        } else {
+          sim.display(width, WINDOW_HEIGHT, x, 0);
+        }
+        simulation.passTimer.end("render");
+      }
+      if (panes > 1) glDisable(GL_SCISSOR_TEST);
+      glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+      if (cacheView) viewCache.store(simulation);
     }
+    if (cacheView) viewCache.present();
 
     renderUI();
 
     glfwSwapBuffers(window);
+
+    if (publishing) {
+      auto now = std::chrono::steady_clock::now();
+      publishMetrics(std::chrono::duration<double>(now - lastFrame).count());
+      lastFrame = now;
+    }
   }
 
   
   shutdownAudio();
 
+  control.stop();
+  metricsServer.stop();
+  simulation.passTimer.cleanup();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();